@@ -32,6 +32,9 @@ class _AnalysisScreenState extends State<AnalysisScreen> {
   final Map<int, String> _multiPvUci = {};
   
   final List<String> _moves = [];
+  // Các nước engine đang có; engine chỉ giữ lịch sử từ _engineRootPly trở đi
+  final List<String> _engineMoves = [];
+  int _engineRootPly = -1; // -1: cần gửi lại toàn bộ position
   bool _isRedTurn = true; 
   bool _gameOverDialogShown = false; 
 
@@ -56,6 +59,7 @@ class _AnalysisScreenState extends State<AnalysisScreen> {
 
   void _initEngine() async {
     await EngineService().startup();
+    _engineRootPly = -1;
     EngineService().engineOutput.listen((line) {
       if (line.startsWith("info")) _parseInfo(line);
       if (line.startsWith("bestmove")) _handleBestMove(line);
@@ -133,18 +137,17 @@ class _AnalysisScreenState extends State<AnalysisScreen> {
       _isAnalyzing = true; 
     });
 
-    EngineService().sendCommand("stop"); 
-    EngineService().sendCommand("setoption name MultiPV value 1");
-    _syncEnginePosition();
-
+    // Cấp thấp dùng Skill Level: 1 thread, giới hạn số node, chọn nước từ
+    // các ứng viên MultiPV thay vì search full sức rồi cắt độ sâu
     String cmd = ""; 
     switch (_difficulty) {
-      case Difficulty.beginner: cmd = "go depth 5"; break;
-      case Difficulty.intermediate: cmd = "go depth 10"; break;
-      case Difficulty.master: cmd = "go depth 16"; break;
-      case Difficulty.grandmaster: cmd = "go wtime 900000 btime 900000"; break; 
+      case Difficulty.beginner: cmd = "skill 3 go depth 5"; break;
+      case Difficulty.intermediate: cmd = "skill 8 go depth 10"; break;
+      case Difficulty.master: cmd = "skill 20 go depth 16"; break;
+      case Difficulty.grandmaster: cmd = "skill 20 go wtime 900000 btime 900000"; break; 
     }
-    EngineService().sendCommand(cmd);
+    // Search đang chạy bị ngắt mà không trả bestmove, nên không lẫn với nước của máy
+    EngineService().sendCommand("reanalyze multipv 1 ${_enginePositionDelta()} $cmd");
   }
 
   void _parseInfo(String line) {
@@ -216,9 +219,36 @@ class _AnalysisScreenState extends State<AnalysisScreen> {
     if (mounted) setState(() {});
   }
 
+  // Chỉ gửi phần thay đổi (undo/append) để engine giữ lịch sử ván cho luật lặp/đuổi
   void _syncEnginePosition() {
-    String currentFen = _boardController.getFen(isRedTurn: _isRedTurn);
-    EngineService().sendCommand("position fen $currentFen");
+    final delta = _enginePositionDelta();
+    if (delta.isNotEmpty) EngineService().sendCommand("position $delta");
+  }
+
+  // Tham số position ("fen ..." hoặc "undo N append ...") để engine khớp với bàn cờ,
+  // chuỗi rỗng nếu engine đã khớp. Coi như engine sẽ nhận lệnh ngay sau đó.
+  String _enginePositionDelta() {
+    String delta = "";
+    int common = 0;
+    while (common < _moves.length && common < _engineMoves.length && _moves[common] == _engineMoves[common]) {
+      common++;
+    }
+
+    if (_engineRootPly < 0 || common < _engineRootPly) {
+      String currentFen = _boardController.getFen(isRedTurn: _isRedTurn);
+      delta = "fen $currentFen";
+      _engineRootPly = _moves.length;
+    } else {
+      final undo = _engineMoves.length - common;
+      final append = _moves.sublist(common);
+      if (undo > 0) delta += "undo $undo";
+      if (append.isNotEmpty) delta += "${delta.isEmpty ? '' : ' '}append ${append.join(' ')}";
+    }
+
+    _engineMoves
+      ..clear()
+      ..addAll(_moves);
+    return delta;
   }
 
   void _onMove(String uciMove) {
@@ -239,10 +269,8 @@ class _AnalysisScreenState extends State<AnalysisScreen> {
   }
 
   void _sendPosToEngineAnalysis() { 
-    EngineService().sendCommand("stop");
-    EngineService().sendCommand("setoption name MultiPV value 3"); 
-    _syncEnginePosition(); 
-    EngineService().sendCommand("go infinite"); 
+    // Một lệnh thay cho stop + setoption MultiPV + position + go infinite
+    EngineService().sendCommand("reanalyze multipv 3 skill 20 ${_enginePositionDelta()} go infinite"); 
   }
   
   void _checkGameState() { 
@@ -288,6 +316,7 @@ class _AnalysisScreenState extends State<AnalysisScreen> {
       
       setState(() { 
         _moves.clear(); 
+        _engineRootPly = -1; 
         _depth = "0"; 
         _scoreValue = 0.0; 
         _isMate = false; 
@@ -313,6 +342,7 @@ class _AnalysisScreenState extends State<AnalysisScreen> {
   void _resetGame() {
     setState(() { 
       _moves.clear(); 
+      _engineRootPly = -1; 
       _depth = "0"; 
       _scoreValue = 0.0; 
       _isMate = false; 
@@ -492,7 +522,7 @@ class _AnalysisScreenState extends State<AnalysisScreen> {
     if (_isComputerThinking) return;
     if (_playMode == PlayMode.vsComputer && _moves.length >= 2) { setState(() { _moves.removeLast(); _moves.removeLast(); _multiPvInfo.clear(); _multiPvUci.clear(); _gameOverDialogShown = false; }); _boardController.undo(); _boardController.undo(); _boardController.clearHint(); } else { setState(() { _moves.removeLast(); _isRedTurn = !_isRedTurn; _multiPvInfo.clear(); _multiPvUci.clear(); _gameOverDialogShown = false; }); _boardController.undo(); _boardController.clearHint(); } _syncEnginePosition(); if (_playMode == PlayMode.analysis) _sendPosToEngineAnalysis(); _showMsg(AppLocalizations.t('undo')); }
   
-  void _toggleTurnManually() { setState(() { _isRedTurn = !_isRedTurn; _multiPvInfo.clear(); _multiPvUci.clear(); _boardController.clearHint(); }); if (_playMode == PlayMode.analysis) _sendPosToEngineAnalysis(); _showMsg(AppLocalizations.t('switch_turn')); }
+  void _toggleTurnManually() { setState(() { _isRedTurn = !_isRedTurn; _engineRootPly = -1; _multiPvInfo.clear(); _multiPvUci.clear(); _boardController.clearHint(); }); if (_playMode == PlayMode.analysis) _sendPosToEngineAnalysis(); _showMsg(AppLocalizations.t('switch_turn')); }
   void _showMsg(String msg) { ScaffoldMessenger.of(context).showSnackBar(SnackBar(content: Text(msg), duration: const Duration(seconds: 1))); }
 
   @override
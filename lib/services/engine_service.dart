@@ -10,10 +10,19 @@ import 'package:path_provider/path_provider.dart';
 // --- ĐỊNH NGHĨA FFI ---
 typedef InitFunc = ffi.Void Function();
 typedef InitFuncDart = void Function();
+typedef ShutdownFunc = ffi.Void Function(ffi.Int32);
+typedef ShutdownFuncDart = void Function(int);
 typedef SendFunc = ffi.Void Function(ffi.Pointer<Utf8>);
 typedef SendFuncDart = void Function(ffi.Pointer<Utf8>);
 typedef ReadFunc = ffi.Int32 Function(ffi.Pointer<Utf8>, ffi.Int32);
 typedef ReadFuncDart = int Function(ffi.Pointer<Utf8>, int);
+typedef SetNetworkBufferFunc = ffi.Void Function(ffi.Pointer<Utf8>, ffi.Pointer<ffi.Void>, ffi.Uint64);
+typedef SetNetworkBufferFuncDart = void Function(ffi.Pointer<Utf8>, ffi.Pointer<ffi.Void>, int);
+typedef SetNetworkCacheDirFunc = ffi.Void Function(ffi.Pointer<Utf8>);
+typedef SetNetworkCacheDirFuncDart = void Function(ffi.Pointer<Utf8>);
+typedef OutputCallback = ffi.Void Function();
+typedef SetOutputCallbackFunc = ffi.Void Function(ffi.Pointer<ffi.NativeFunction<OutputCallback>>);
+typedef SetOutputCallbackFuncDart = void Function(ffi.Pointer<ffi.NativeFunction<OutputCallback>>);
 
 class EngineService {
   static final EngineService _instance = EngineService._internal();
@@ -35,13 +44,21 @@ class EngineService {
   Process? _process;
   StreamSubscription? _stdoutSubscription;
   Timer? _iosOutputTimer;
+  ffi.NativeCallable<OutputCallback>? _iosOutputCallback;
+  SetOutputCallbackFuncDart? _iosSetOutputCallback;
   InitFuncDart? _iosInit;
+  ShutdownFuncDart? _iosShutdown;
   SendFuncDart? _iosSend;
   ReadFuncDart? _iosRead;
   bool _isReady = false;
   String _absoluteNnuePath = "";
+  // NNUE nằm trong bộ nhớ native, engine đọc thẳng từ đây (giữ suốt đời App)
+  ffi.Pointer<ffi.Uint8>? _nnueBuffer;
+  int _nnueBufferSize = 0;
+  bool _nnueInMemory = false;
 
   static const platform = MethodChannel('com.example.co_tuong_ai/engine_channel');
+  static const int _iosReadBufferSize = 64 * 1024;
 
   // Hàm ghi log vừa in ra Console vừa bắn ra màn hình
   void _log(String msg) {
@@ -50,22 +67,30 @@ class EngineService {
   }
 
   Future<void> startup() async {
-    await shutdown();
+    // Khởi động lại: giữ network đã nạp để không phải giải nén lại
+    await shutdown(keepNetwork: true);
     _log("🚀 BẮT ĐẦU KHỞI ĐỘNG ENGINE...");
     _isRunning = true;
 
     try {
       final appSupportDir = await getApplicationSupportDirectory();
       _absoluteNnuePath = "${appSupportDir.path}/pikafish.nnue";
-      
-      _log("📂 Đang copy NNUE vào: $_absoluteNnuePath");
-      await _copyAssetToFile("assets/engine/pikafish.nnue", _absoluteNnuePath);
-      
-      // Kiểm tra file sau khi copy
-      if (File(_absoluteNnuePath).existsSync()) {
-         _log("✅ File NNUE đã tồn tại. Size: ${File(_absoluteNnuePath).lengthSync()} bytes");
+
+      // iOS: đưa NNUE cho engine qua bộ nhớ, không copy asset ra file
+      _nnueInMemory = Platform.isIOS && await _registerNnueBuffer();
+
+      if (_nnueInMemory) {
+        _log("✅ NNUE nạp từ bộ nhớ. Size: $_nnueBufferSize bytes");
       } else {
-         _log("❌ LỖI: Không thấy file NNUE sau khi copy!");
+        _log("📂 Đang copy NNUE vào: $_absoluteNnuePath");
+        await _copyAssetToFile("assets/engine/pikafish.nnue", _absoluteNnuePath);
+
+        // Kiểm tra file sau khi copy
+        if (File(_absoluteNnuePath).existsSync()) {
+           _log("✅ File NNUE đã tồn tại. Size: ${File(_absoluteNnuePath).lengthSync()} bytes");
+        } else {
+           _log("❌ LỖI: Không thấy file NNUE sau khi copy!");
+        }
       }
 
       if (Platform.isIOS) {
@@ -87,15 +112,27 @@ class EngineService {
       _log("🔍 Đang tìm hàm C++...");
       _iosInit = dylib.lookupFunction<InitFunc, InitFuncDart>('init_pikafish_ios');
       _iosSend = dylib.lookupFunction<SendFunc, SendFuncDart>('send_command_ios');
-      _iosRead = dylib.lookupFunction<ReadFunc, ReadFuncDart>('read_stdout_ios');
+      _iosRead = dylib.lookupFunction<ReadFunc, ReadFuncDart>('read_all_stdout_ios');
+      _iosShutdown = dylib.lookupFunction<ShutdownFunc, ShutdownFuncDart>('shutdown_pikafish_ios');
       
+      await _setNetworkCacheDir(dylib);
+
       _log("✅ Đã tìm thấy hàm. Đang gọi init...");
       _iosInit!();
       _log("✅ Đã gọi init_pikafish_ios thành công!");
 
-      _iosOutputTimer = Timer.periodic(const Duration(milliseconds: 50), (timer) {
-        _readIOSOutput();
-      });
+      // Engine báo khi có output mới (đã gộp), không cần polling
+      try {
+        _iosSetOutputCallback = dylib.lookupFunction<SetOutputCallbackFunc, SetOutputCallbackFuncDart>(
+            'set_output_callback_ios');
+        _iosOutputCallback = ffi.NativeCallable<OutputCallback>.listener(_readIOSOutput);
+        _iosSetOutputCallback!(_iosOutputCallback!.nativeFunction);
+      } catch (e) {
+        _log("⚠️ Không có set_output_callback_ios, dùng polling: $e");
+        _iosOutputTimer = Timer.periodic(const Duration(milliseconds: 50), (timer) {
+          _readIOSOutput();
+        });
+      }
 
       _log("📤 Gửi lệnh: uci");
       sendCommand("uci");
@@ -109,10 +146,11 @@ class EngineService {
 
   void _readIOSOutput() {
     if (_iosRead == null) return;
-    final ffi.Pointer<ffi.Uint8> buffer = calloc<ffi.Uint8>(4096); 
+    final ffi.Pointer<ffi.Uint8> buffer = calloc<ffi.Uint8>(_iosReadBufferSize);
     try {
-      int bytesRead = _iosRead!(buffer.cast<Utf8>(), 4096);
-      if (bytesRead > 0) {
+      // Lấy hết các dòng đang chờ trong một lần gọi FFI
+      int bytesRead;
+      while ((bytesRead = _iosRead!(buffer.cast<Utf8>(), _iosReadBufferSize)) > 0) {
         String chunk = buffer.cast<Utf8>().toDartString(length: bytesRead);
         // _log("📥 Nhận từ Engine: $chunk"); // Uncomment nếu muốn xem raw
         LineSplitter ls = const LineSplitter();
@@ -144,7 +182,10 @@ class EngineService {
     // _log("Engine nói: $line"); // Log mọi thứ engine nói
     if (line == "uciok") {
       _log("✅ NHẬN ĐƯỢC UCIOK -> Gửi cấu hình...");
-      sendCommand("setoption name EvalFile value $_absoluteNnuePath");
+      // NNUE trong bộ nhớ đã được nạp khi engine khởi động
+      if (!_nnueInMemory) {
+        sendCommand("setoption name EvalFile value $_absoluteNnuePath");
+      }
       sendCommand("setoption name Threads value 4"); 
       sendCommand("setoption name Hash value 64"); 
       sendCommand("isready");
@@ -174,18 +215,67 @@ class EngineService {
     }
   }
 
-  Future<void> shutdown() async {
+  Future<void> shutdown({bool keepNetwork = false}) async {
     _isRunning = false;
     _log("🛑 Đang tắt Engine...");
     if (Platform.isIOS) {
-      sendCommand("quit");
       _iosOutputTimer?.cancel();
+      _iosSetOutputCallback?.call(ffi.nullptr);
+      if (_iosShutdown != null) {
+        // Dừng search, join thread engine, giải phóng TT/network/thread
+        _iosShutdown!(keepNetwork ? 1 : 0);
+        _readIOSOutput();
+      } else {
+        sendCommand("quit");
+      }
+      _iosOutputCallback?.close();
+      _iosOutputCallback = null;
     } else {
       _process?.kill();
       _process = null;
     }
   }
 
+  // Copy asset NNUE (nén) vào bộ nhớ native một lần rồi đăng ký với engine
+  // bằng set_network_buffer_ios, phải gọi trước init_pikafish_ios.
+  Future<bool> _registerNnueBuffer() async {
+    try {
+      final dylib = ffi.DynamicLibrary.process();
+      final setBuffer = dylib.lookupFunction<SetNetworkBufferFunc, SetNetworkBufferFuncDart>(
+          'set_network_buffer_ios');
+
+      if (_nnueBuffer == null) {
+        final data = await rootBundle.load("assets/engine/pikafish.nnue");
+        final bytes = data.buffer.asUint8List(data.offsetInBytes, data.lengthInBytes);
+        _nnueBuffer = malloc<ffi.Uint8>(bytes.length);
+        _nnueBuffer!.asTypedList(bytes.length).setAll(0, bytes);
+        _nnueBufferSize = bytes.length;
+      }
+
+      setBuffer(ffi.nullptr, _nnueBuffer!.cast(), _nnueBufferSize);
+      return true;
+    } catch (e) {
+      _log("⚠️ Không đưa được NNUE vào bộ nhớ, dùng file: $e");
+      return false;
+    }
+  }
+
+  // Cache network đã giải nén vào thư mục cache của App (hệ điều hành có thể
+  // xoá khi thiếu chỗ), các lần khởi động sau đọc cache thay vì giải nén lại.
+  // Phải gọi trước init_pikafish_ios.
+  Future<void> _setNetworkCacheDir(ffi.DynamicLibrary dylib) async {
+    try {
+      final setCacheDir = dylib.lookupFunction<SetNetworkCacheDirFunc, SetNetworkCacheDirFuncDart>(
+          'set_network_cache_dir_ios');
+      final cacheDir = await getApplicationCacheDirectory();
+      final cStr = cacheDir.path.toNativeUtf8();
+      setCacheDir(cStr);
+      calloc.free(cStr);
+    } catch (e) {
+      _log("⚠️ Không bật được cache network, engine giải nén mỗi lần: $e");
+    }
+  }
+
   Future<void> _copyAssetToFile(String assetKey, String filePath) async {
     try {
       if (!File(filePath).existsSync() || File(filePath).lengthSync() == 0) {
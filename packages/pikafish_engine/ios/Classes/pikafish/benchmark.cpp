@@ -19,11 +19,29 @@
 #include "benchmark.h"
 #include "numa.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdlib>
+#include <deque>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <numeric>
+#include <sstream>
+#include <tuple>
 #include <vector>
 
+#include "bitboard.h"
+#include "evaluate.h"
+#include "memory.h"
+#include "movegen.h"
+#include "nnue/network.h"
+#include "nnue/nnue_accumulator.h"
+#include "perft.h"
+#include "position.h"
+#include "tt.h"
+
 namespace {
 
 // clang-format off
@@ -503,4 +521,541 @@ BenchmarkSetup setup_benchmark(std::istream& is) {
     return setup;
 }
 
+// Parses the arguments of "speedtest scaling": the maximum thread count,
+// the search depth, and "hash" followed by the TT sizes to sweep, e.g.
+//
+// speedtest scaling                 : 1, 2, 4... all threads, depth 12, 64 MiB
+// speedtest scaling 8 14 hash 16 256 : 1, 2, 4, 8 threads, depth 14, 16 and 256 MiB
+ScalingSetup setup_scaling(std::istream& is) {
+
+    static constexpr int DEFAULT_DEPTH   = 12;
+    static constexpr int DEFAULT_HASH_MB = 64;
+
+    ScalingSetup setup{};
+    std::string  token;
+    int          maxThreads;
+
+    if (!(is >> maxThreads) || maxThreads < 1)
+        maxThreads = get_hardware_concurrency();
+
+    if (!(is >> setup.depth) || setup.depth < 1)
+        setup.depth = DEFAULT_DEPTH;
+
+    is.clear();
+    if (is >> token && token == "hash")
+        for (int mb; is >> mb;)
+            setup.hashSizes.push_back(std::max(mb, 1));
+
+    if (setup.hashSizes.empty())
+        setup.hashSizes.push_back(DEFAULT_HASH_MB);
+
+    for (int t = 1; t < maxThreads; t *= 2)
+        setup.threads.push_back(t);
+    setup.threads.push_back(maxThreads);
+
+    for (const std::string& fen : Defaults)
+    {
+        setup.commands.emplace_back("position fen " + fen);
+        setup.commands.emplace_back("go depth " + std::to_string(setup.depth));
+    }
+
+    return setup;
+}
+
+MovegenCheckResult check_movegen(int depth) {
+
+    MovegenCheckResult result;
+
+    for (const std::string& fen : Defaults)
+    {
+        StateInfo st;
+        Position  pos;
+        pos.set(fen, &st);
+
+        result.mismatches += movegen_check(pos, depth, result.nodes);
+    }
+
+    return result;
+}
+
+const std::vector<std::string>& chase_bench_positions() {
+    // clang-format off
+    static const std::vector<std::string> positions = {
+        "fen 3k5/9/9/9/9/2c6/9/9/4R4/4K4 w moves e1f1 c4c5 f1e1 c5c4 e1f1 c4c5 f1e1 c5c4",
+        "fen 3ak4/9/4b4/9/2r6/9/6R2/9/4A4/4K4 w moves g3h3 c5b5 h3g3 b5c5 g3h3 c5b5 h3g3 b5c5",
+        "fen 4k4/9/4b4/p8/9/2C3n2/9/4B4/9/3AK4 w moves c4c3 g4h6 c3c4 h6g4 c4c3 g4h6 c3c4 h6g4",
+        "fen 2bak4/4a4/2n1b4/9/2p3r2/6P2/2N1C4/4B4/4A4/2BK1A3 w moves c3b5 g5h5 b5c3 h5g5 c3b5 g5h5 b5c3 h5g5"
+    };
+    // clang-format on
+
+    return positions;
+}
+
+namespace {
+
+// Each run repeats its pass for at least this long
+constexpr auto MicrobenchRunTime = std::chrono::milliseconds(100);
+
+// Repeats of each move in the incremental NNUE pass, so the refresh of the
+// root accumulator is spread over many updates
+constexpr int IncrementalRepeats = 8;
+
+// Runs 'pass', which returns the number of operations it made, once to warm up
+// and then for 'runs' runs, and collects the time per operation of each run.
+template<typename Pass>
+MicrobenchResult measure(const std::string& name, int runs, Pass&& pass) {
+
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<double> samples;
+    uint64_t            totalOps = pass();
+
+    for (int r = 0; r < runs; ++r)
+    {
+        uint64_t                 ops   = 0;
+        const auto               start = Clock::now();
+        std::chrono::nanoseconds elapsed;
+
+        do
+        {
+            ops += pass();
+            elapsed = Clock::now() - start;
+        } while (elapsed < MicrobenchRunTime);
+
+        samples.push_back(double(elapsed.count()) / ops);
+        totalOps += ops;
+    }
+
+    const double mean     = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    double       variance = 0;
+    for (double x : samples)
+        variance += (x - mean) * (x - mean) / samples.size();
+
+    return {name, mean, variance, *std::min_element(samples.begin(), samples.end()), totalOps};
+}
+
+template<PieceType Pt>
+uint64_t attacks_pass(const std::deque<Position>& positions, volatile uint64_t& sink) {
+
+    uint64_t acc = 0, ops = 0;
+
+    for (const Position& pos : positions)
+        for (Square s = SQ_A0; s <= SQ_I9; ++s, ++ops)
+        {
+            Bitboard b;
+            if constexpr (Pt == PAWN)
+                b = attacks_bb<PAWN>(s, pos.side_to_move());
+            else
+                b = attacks_bb<Pt>(s, pos.pieces());
+            acc += uint64_t(b) ^ uint64_t(b >> 64);
+        }
+
+    sink = sink + acc;
+    return ops;
+}
+
+}  // namespace
+
+// Times the hot primitives of the engine over the bench positions. The
+// evasions are timed over the children of these positions that are in check.
+// nnue_incremental includes a do_move()/undo_move() pair per operation, which
+// do_undo_move gives on its own.
+std::vector<MicrobenchResult>
+microbench(const Eval::NNUE::Networks& networks, const TranspositionTable& tt, int runs) {
+
+    std::deque<StateInfo>          states;
+    std::deque<Position>           positions, evasions;
+    std::vector<std::vector<Move>> moves;
+    std::vector<Key>               keys;
+
+    for (const std::string& fen : Defaults)
+    {
+        Position& pos = positions.emplace_back();
+        pos.set(fen, &states.emplace_back());
+
+        auto& legal = moves.emplace_back();
+        keys.push_back(pos.key());
+
+        for (const auto& m : MoveList<LEGAL>(pos))
+        {
+            legal.push_back(m);
+
+            StateInfo st;
+            bool      givesCheck = pos.gives_check(m);
+            pos.do_move(m, st, givesCheck, nullptr);
+            keys.push_back(pos.key());
+            if (givesCheck)
+                evasions.emplace_back().set(pos.fen(), &states.emplace_back());
+            pos.undo_move(m);
+        }
+    }
+
+    volatile uint64_t             sink = 0;
+    std::vector<MicrobenchResult> results;
+
+    auto add = [&](const std::string& name, auto&& pass) {
+        results.push_back(measure(name, runs, pass));
+    };
+
+    add("do_undo_move", [&]() {
+        uint64_t ops = 0;
+        for (size_t i = 0; i < positions.size(); ++i)
+            for (Move m : moves[i])
+            {
+                StateInfo st;
+                positions[i].do_move(m, st);
+                positions[i].undo_move(m);
+                ++ops;
+            }
+        return ops;
+    });
+
+    auto generate_pass = [&](auto gen, const std::deque<Position>& list) {
+        return [&, gen]() {
+            Move     buf[MAX_MOVES];
+            uint64_t acc = 0;
+            for (const Position& pos : list)
+                acc += gen(pos, buf) - buf;
+            sink = sink + acc;
+            return uint64_t(list.size());
+        };
+    };
+
+    add("generate_captures", generate_pass(generate<CAPTURES>, positions));
+    add("generate_quiets", generate_pass(generate<QUIETS>, positions));
+    add("generate_evasions", generate_pass(generate<EVASIONS>, evasions));
+    add("generate_legal", generate_pass(generate<LEGAL>, positions));
+
+    add("see_ge", [&]() {
+        uint64_t acc = 0, ops = 0;
+        for (size_t i = 0; i < positions.size(); ++i)
+            for (Move m : moves[i])
+                acc += positions[i].see_ge(m), ++ops;
+        sink = sink + acc;
+        return ops;
+    });
+
+    add("attacks_rook", [&]() { return attacks_pass<ROOK>(positions, sink); });
+    add("attacks_advisor", [&]() { return attacks_pass<ADVISOR>(positions, sink); });
+    add("attacks_cannon", [&]() { return attacks_pass<CANNON>(positions, sink); });
+    add("attacks_pawn", [&]() { return attacks_pass<PAWN>(positions, sink); });
+    add("attacks_knight", [&]() { return attacks_pass<KNIGHT>(positions, sink); });
+    add("attacks_bishop", [&]() { return attacks_pass<BISHOP>(positions, sink); });
+    add("attacks_king", [&]() { return attacks_pass<KING>(positions, sink); });
+
+    add("tt_probe", [&]() {
+        uint64_t acc = 0;
+        for (Key k : keys)
+            acc += std::get<0>(tt.probe(k));
+        sink = sink + acc;
+        return uint64_t(keys.size());
+    });
+
+    using namespace Eval::NNUE;
+
+    struct alignas(CacheLineSize) Features {
+        TransformedFeatureType data[BigFeatureTransformer::BufferSize];
+        int                    bucket;
+    };
+
+    const auto&           network = networks.big;
+    auto                  stack   = make_unique_aligned<AccumulatorStack>();
+    auto                  caches  = make_unique_aligned<AccumulatorCaches>(networks);
+    std::vector<Features> features(positions.size());
+
+    add("nnue_refresh", [&]() {
+        for (size_t i = 0; i < positions.size(); ++i)
+        {
+            stack->reset();
+            features[i].bucket =
+              network.transform(positions[i], *stack, &caches->big, features[i].data);
+        }
+        return uint64_t(positions.size());
+    });
+
+    add("nnue_incremental", [&]() {
+        Features out;
+        uint64_t ops = 0;
+        for (size_t i = 0; i < positions.size(); ++i)
+        {
+            Position& pos = positions[i];
+            stack->reset();
+            network.transform(pos, *stack, &caches->big, out.data);
+
+            for (int r = 0; r < IncrementalRepeats; ++r)
+                for (Move m : moves[i])
+                {
+                    StateInfo st;
+                    stack->push(pos.do_move(m, st, pos.gives_check(m), nullptr));
+                    network.transform(pos, *stack, &caches->big, out.data);
+                    stack->pop();
+                    pos.undo_move(m);
+                    ++ops;
+                }
+        }
+        return ops;
+    });
+
+    add("nnue_propagate", [&]() {
+        uint64_t acc = 0;
+        for (const Features& f : features)
+            acc += network.propagate(f.data, f.bucket);
+        sink = sink + acc;
+        return uint64_t(features.size());
+    });
+
+    return results;
+}
+
+#if defined(USE_FT_INT8)
+namespace {
+
+// One network in place of Networks, to give it accumulator caches of its own
+template<typename Network>
+struct SingleNetwork {
+    const Network& big;
+};
+
+// Times transform() of a network as nnue_refresh and nnue_incremental of
+// microbench do, with 'weights' appended to the names of the results.
+template<typename Network>
+void time_transform(const Network&                        network,
+                    const std::string&                    weights,
+                    std::deque<Position>&                 positions,
+                    const std::vector<std::vector<Move>>& moves,
+                    int                                   runs,
+                    std::vector<MicrobenchResult>&        results) {
+
+    using namespace Eval::NNUE;
+
+    alignas(CacheLineSize) TransformedFeatureType out[BigFeatureTransformer::BufferSize];
+
+    auto stack  = make_unique_aligned<AccumulatorStack>();
+    auto caches = make_unique_aligned<AccumulatorCaches>(SingleNetwork<Network>{network});
+
+    results.push_back(measure("nnue_refresh_" + weights, runs, [&]() {
+        for (const Position& pos : positions)
+        {
+            stack->reset();
+            network.transform(pos, *stack, &caches->big, out);
+        }
+        return uint64_t(positions.size());
+    }));
+
+    results.push_back(measure("nnue_incremental_" + weights, runs, [&]() {
+        uint64_t ops = 0;
+        for (size_t i = 0; i < positions.size(); ++i)
+        {
+            Position& pos = positions[i];
+            stack->reset();
+            network.transform(pos, *stack, &caches->big, out);
+
+            for (int r = 0; r < IncrementalRepeats; ++r)
+                for (Move m : moves[i])
+                {
+                    StateInfo st;
+                    stack->push(pos.do_move(m, st, pos.gives_check(m), nullptr));
+                    network.transform(pos, *stack, &caches->big, out);
+                    stack->pop();
+                    pos.undo_move(m);
+                    ++ops;
+                }
+        }
+        return ops;
+    }));
+}
+
+}  // namespace
+
+// Compares the int8 feature transformer weights of the loaded network with the
+// int16 weights of its network file, loaded once more without a cache file:
+// the network output over the bench positions and the positions two plies from
+// them, their size and the time transform() takes.
+std::string compare_ft_weights(const Eval::NNUE::Networks& networks,
+                               const std::string&          rootDirectory,
+                               const std::string&          evalFile,
+                               int                         runs) {
+
+    using namespace Eval::NNUE;
+
+    const std::string file = evalFile.empty() ? EvalFileDefaultNameBig : evalFile;
+
+    if (!networks.big.is_loaded(file))
+        return "The network file " + file + " is not loaded";
+
+    const EvalFile noFile{EvalFileDefaultNameBig, "None", ""};
+
+    auto              net16 = make_unique_large_page<NetworkBigInt16>(noFile);
+    const NetworkBig* net8  = &networks.big;
+
+    net16->load(rootDirectory, file, "");
+
+    if (!net16->is_loaded(file))
+        return "The network file " + file + " could not be loaded";
+
+    auto stack16  = make_unique_aligned<AccumulatorStack>();
+    auto stack8   = make_unique_aligned<AccumulatorStack>();
+    auto caches16 = make_unique_aligned<AccumulatorCaches>(SingleNetwork<NetworkBigInt16>{*net16});
+    auto caches8  = make_unique_aligned<AccumulatorCaches>(SingleNetwork<NetworkBigInt8>{*net8});
+
+    uint64_t count = 0, sameSign = 0, within1 = 0, within4 = 0, within16 = 0;
+    double   sumOutput = 0, sumError = 0, sumSquaredError = 0;
+    int      maxError  = 0;
+
+    auto compare = [&](const Position& pos) {
+        const auto [psqt16, positional16] = net16->evaluate(pos, *stack16, &caches16->big);
+        const auto [psqt8, positional8]   = net8->evaluate(pos, *stack8, &caches8->big);
+
+        const int output16 = psqt16 + positional16;
+        const int output8  = psqt8 + positional8;
+        const int error    = std::abs(output8 - output16);
+
+        ++count;
+        sameSign += (output8 > 0) == (output16 > 0);
+        within1 += error <= 1;
+        within4 += error <= 4;
+        within16 += error <= 16;
+        sumOutput += std::abs(output16);
+        sumError += error;
+        sumSquaredError += double(error) * error;
+        maxError = std::max(maxError, error);
+    };
+
+    auto do_move = [&](Position& pos, Move m, StateInfo& st) {
+        const DirtyPiece dp = pos.do_move(m, st, pos.gives_check(m), nullptr);
+        stack16->push(dp);
+        stack8->push(dp);
+    };
+
+    auto undo_move = [&](Position& pos, Move m) {
+        stack16->pop();
+        stack8->pop();
+        pos.undo_move(m);
+    };
+
+    std::deque<StateInfo>          states;
+    std::deque<Position>           positions;
+    std::vector<std::vector<Move>> moves;
+
+    for (const std::string& fen : Defaults)
+    {
+        Position& pos = positions.emplace_back();
+        pos.set(fen, &states.emplace_back());
+
+        auto& legal = moves.emplace_back();
+        for (const auto& m : MoveList<LEGAL>(pos))
+            legal.push_back(m);
+
+        stack16->reset();
+        stack8->reset();
+        compare(pos);
+
+        for (Move m : legal)
+        {
+            StateInfo st;
+            do_move(pos, m, st);
+            compare(pos);
+
+            for (const auto& m2 : MoveList<LEGAL>(pos))
+            {
+                StateInfo st2;
+                do_move(pos, m2, st2);
+                compare(pos);
+                undo_move(pos, m2);
+            }
+
+            undo_move(pos, m);
+        }
+    }
+
+    std::vector<MicrobenchResult> results;
+    time_transform(*net16, "int16", positions, moves, runs, results);
+    time_transform(*net8, "int8", positions, moves, runs, results);
+
+    auto percent = [&](uint64_t n) { return 100.0 * n / count; };
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2)  //
+       << "\nint16 network file                : " << file
+       << "\nPositions compared                : " << count
+       << "\nMean absolute int16 output        : " << sumOutput / count
+       << "\nMean absolute int8 error          : " << sumError / count
+       << "\nRoot mean square int8 error       : " << std::sqrt(sumSquaredError / count)
+       << "\nMaximum int8 error                : " << maxError
+       << "\nint8 error at most 1, 4, 16 [%]   : " << percent(within1) << ", " << percent(within4)
+       << ", " << percent(within16)
+       << "\nint8 output of the same sign [%]  : " << percent(sameSign)
+       << "\nNetwork size int16, int8 [MiB]    : " << sizeof(NetworkBigInt16) / 1048576.0 << ", "
+       << sizeof(NetworkBigInt8) / 1048576.0;
+
+    for (size_t i = 0; i < results.size() / 2; ++i)
+    {
+        const MicrobenchResult& r16 = results[i];
+        const MicrobenchResult& r8  = results[i + results.size() / 2];
+        const std::string       name = r16.name.substr(0, r16.name.rfind('_'));
+
+        ss << "\n" << std::left << std::setw(34) << name + " int16, int8 [ns]" << std::right
+           << ": " << r16.nsPerOp << ", " << r8.nsPerOp << " (" << std::showpos
+           << 100 * (r8.nsPerOp / r16.nsPerOp - 1) << std::noshowpos << "%)";
+    }
+
+    return ss.str();
+}
+#endif
+
+std::string microbench_json(const std::vector<MicrobenchResult>&  results,
+                            const std::map<std::string, double>& baseline) {
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3) << "{\n  \"results\": [";
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const MicrobenchResult& r = results[i];
+
+        ss << (i ? "," : "") << "\n    {\"name\": \"" << r.name << "\""
+           << ", \"ns_per_op\": " << r.nsPerOp << ", \"variance\": " << r.variance
+           << ", \"min\": " << r.min << ", \"ops\": " << r.ops;
+
+        if (auto it = baseline.find(r.name); it != baseline.end())
+            ss << ", \"baseline\": " << it->second
+               << ", \"change_pct\": " << 100 * (r.nsPerOp - it->second) / it->second;
+
+        ss << "}";
+    }
+
+    ss << "\n  ]\n}";
+    return ss.str();
+}
+
+// Reads the ns/op of each result from JSON written by microbench_json(),
+// which puts one result per line.
+std::map<std::string, double> read_microbench(std::istream& is) {
+
+    std::map<std::string, double> baseline;
+
+    for (std::string line; std::getline(is, line);)
+    {
+        const auto name = line.find("\"name\": \"");
+        const auto ns   = line.find("\"ns_per_op\": ");
+
+        if (name == std::string::npos || ns == std::string::npos)
+            continue;
+
+        const auto   begin   = name + 9;
+        const auto   end     = line.find('"', begin);
+        const char*  number  = line.c_str() + ns + 13;
+        char*        parsed  = nullptr;
+        const double nsPerOp = std::strtod(number, &parsed);
+
+        // A hand edited or truncated file may hold anything, skip such lines
+        if (end == std::string::npos || parsed == number || !std::isfinite(nsPerOp))
+            continue;
+
+        baseline[line.substr(begin, end - begin)] = nsPerOp;
+    }
+
+    return baseline;
+}
+
 }  // namespace Stockfish
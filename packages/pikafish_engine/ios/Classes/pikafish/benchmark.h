@@ -19,10 +19,19 @@
 #ifndef BENCHMARK_H_INCLUDED
 #define BENCHMARK_H_INCLUDED
 
+#include <cstdint>
 #include <iosfwd>
+#include <map>
 #include <string>
 #include <vector>
 
+namespace Stockfish {
+class TranspositionTable;
+namespace Eval::NNUE {
+struct Networks;
+}
+}
+
 namespace Stockfish::Benchmark {
 
 std::vector<std::string> setup_bench(const std::string&, std::istream&);
@@ -37,6 +46,55 @@ struct BenchmarkSetup {
 
 BenchmarkSetup setup_benchmark(std::istream&);
 
+// Workload of the thread scaling mode of speedtest: the bench positions
+// searched to a fixed depth at each thread count and hash size.
+struct ScalingSetup {
+    std::vector<int>         threads;    // 1, 2, 4... and the maximum
+    std::vector<int>         hashSizes;  // In MiB
+    int                      depth;
+    std::vector<std::string> commands;
+};
+
+ScalingSetup setup_scaling(std::istream&);
+
+// Endgames with shuffling moves in their history, in "position" syntax
+const std::vector<std::string>& chase_bench_positions();
+
+// Result of check_movegen(): generate<LEGAL> compared with the legality test
+// it replaces, at each node of the bench positions up to a depth.
+struct MovegenCheckResult {
+    uint64_t nodes      = 0;  // Leaf count, the perft signature of the depth
+    uint64_t mismatches = 0;  // Nodes where the two move lists differ
+};
+
+MovegenCheckResult check_movegen(int depth);
+
+// Timing of one primitive: mean, variance and minimum of the time per
+// operation over the runs, in nanoseconds.
+struct MicrobenchResult {
+    std::string name;
+    double      nsPerOp, variance, min;
+    uint64_t    ops;
+};
+
+std::vector<MicrobenchResult>
+microbench(const Eval::NNUE::Networks&, const TranspositionTable&, int runs);
+
+#if defined(USE_FT_INT8)
+// Compares the int8 feature transformer weights of the loaded network with the
+// int16 weights of its network file: network output, size and speed.
+std::string compare_ft_weights(const Eval::NNUE::Networks& networks,
+                               const std::string&          rootDirectory,
+                               const std::string&          evalFile,
+                               int                         runs);
+#endif
+
+// Formats the results as JSON. With a baseline (name -> ns/op), as read by
+// read_microbench(), each result also gets the baseline and the change in percent.
+std::string                   microbench_json(const std::vector<MicrobenchResult>&,
+                                              const std::map<std::string, double>& baseline);
+std::map<std::string, double> read_microbench(std::istream&);
+
 }  // namespace Stockfish
 
 #endif  // #ifndef BENCHMARK_H_INCLUDED
@@ -0,0 +1,175 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Entry point of the binary built by 'make dispatch'. The build holds a full
+// copy of the engine for each arch of DISPATCH_ARCHS, compiled with that arch's
+// flags and partially linked so that only its entry points are global:
+//
+//   pikafish_main_<arch>       pikafish_main() of main.cpp
+//   uci_inject_command_<arch>  uci_inject_command() of uci.cpp
+//   pikafish_init_<arch>       its static initializers, renamed from .init_array
+//                              so that the loader does not run them
+//
+// main() picks the best copy the CPU supports, runs its static initializers
+// and hands over to it. Copies left out of the build are weak null symbols.
+
+#if defined(USE_DISPATCH)
+
+    #include <cstdio>
+    #include <cstdlib>
+    #include <cstring>
+    #include <iostream>
+    #include <string>
+    #include <thread>
+
+    #include "uci.h"
+
+using InitFunc = void (*)();
+
+    #define DECLARE_TARGET(id) \
+        extern "C" int      pikafish_main_##id(int, char**) __attribute__((weak)); \
+        extern "C" void     uci_inject_command_##id(const char*) __attribute__((weak)); \
+        extern "C" InitFunc __start_pikafish_init_##id[] __attribute__((weak)); \
+        extern "C" InitFunc __stop_pikafish_init_##id[] __attribute__((weak));
+
+DECLARE_TARGET(x86_64_avx512icl)
+DECLARE_TARGET(x86_64_vnni512)
+DECLARE_TARGET(x86_64_avx512bw)
+DECLARE_TARGET(x86_64_avx512)
+DECLARE_TARGET(x86_64_avxvnni)
+DECLARE_TARGET(x86_64_bmi2)
+DECLARE_TARGET(x86_64_avx2)
+DECLARE_TARGET(x86_64_sse41_popcnt)
+DECLARE_TARGET(x86_64)
+
+    #undef DECLARE_TARGET
+
+namespace {
+
+struct Target {
+    const char* arch;
+    bool (*supported)();
+    int (*main)(int, char**);
+    void (*inject_command)(const char*);
+    InitFunc* initBegin;
+    InitFunc* initEnd;
+};
+
+    #define TARGET(id, arch, cond) \
+        {arch, [] { return bool(cond); }, pikafish_main_##id, uci_inject_command_##id, \
+         __start_pikafish_init_##id, __stop_pikafish_init_##id}
+
+    #define has(feature) __builtin_cpu_supports(feature)
+
+// pext is microcoded and slow on AMD before Zen 3
+bool fast_pext() {
+    return has("bmi2") && !__builtin_cpu_is("amdfam15h") && !__builtin_cpu_is("amdfam17h");
+}
+
+bool avx2() { return has("avx2") && has("bmi") && has("popcnt"); }
+
+bool avx512() { return avx2() && has("bmi2") && has("avx512f"); }
+
+bool vnni512() {
+    return avx512() && has("avx512bw") && has("avx512vnni") && has("avx512dq") && has("avx512vl");
+}
+
+// Best first, with the CPU features the Makefile enables for each arch. These
+// are the archs of DISPATCH_ARCHS in the Makefile, which checks that it names
+// no other arch.
+const Target Targets[] = {
+  TARGET(x86_64_avx512icl, "x86-64-avx512icl",
+         vnni512() && has("avx512cd") && has("avx512ifma") && has("avx512vbmi")
+           && has("avx512vbmi2") && has("avx512vpopcntdq") && has("avx512bitalg")
+           && has("vpclmulqdq") && has("gfni") && has("vaes")),
+  TARGET(x86_64_vnni512, "x86-64-vnni512", vnni512()),
+  TARGET(x86_64_avx512bw, "x86-64-avx512bw", avx512() && has("avx512bw")),
+  TARGET(x86_64_avx512, "x86-64-avx512", avx512()),
+  TARGET(x86_64_avxvnni, "x86-64-avxvnni", avx2() && fast_pext() && has("avxvnni")),
+  TARGET(x86_64_bmi2, "x86-64-bmi2", avx2() && fast_pext()),
+  TARGET(x86_64_avx2, "x86-64-avx2", avx2()),
+  TARGET(x86_64_sse41_popcnt, "x86-64-sse41-popcnt", has("sse4.1") && has("popcnt")),
+  TARGET(x86_64, "x86-64", true),
+};
+
+// The first built copy the CPU supports, or with PIKAFISH_ARCH set the one of
+// that arch, for comparing copies on the same machine.
+const Target* select_target() {
+
+    const char* forced = std::getenv("PIKAFISH_ARCH");
+
+    __builtin_cpu_init();
+
+    for (const Target& t : Targets)
+        if (t.main && t.inject_command && (!forced || !std::strcmp(forced, t.arch)))
+        {
+            if (t.supported())
+                return &t;
+
+            if (forced)
+                std::fprintf(stderr, "PIKAFISH_ARCH=%s is not supported by this CPU\n", forced);
+        }
+
+    return nullptr;
+}
+
+}  // namespace
+
+extern "C" void write_to_dart_buffer(const char* text) {
+    std::fputs(text, stdout);
+    std::fputc('\n', stdout);
+    std::fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+
+    const Target* target = select_target();
+
+    if (!target)
+    {
+        std::fprintf(stderr, "No engine copy in this build runs on this CPU\n");
+        return EXIT_FAILURE;
+    }
+
+    for (InitFunc* f = target->initBegin; f != target->initEnd; ++f)
+        (*f)();
+
+    // Commands given on the command line are run by the engine itself
+    if (argc > 1)
+        return target->main(argc, argv);
+
+    // Otherwise the engine waits for commands, fed to it from stdin
+    std::thread engine([&] { target->main(1, argv); });
+
+    std::string line;
+    while (std::getline(std::cin, line))
+    {
+        target->inject_command(line.c_str());
+        if (line == "quit")
+            break;
+    }
+
+    if (!std::cin)
+        target->inject_command("quit");
+
+    engine.join();
+
+    return EXIT_SUCCESS;
+}
+
+#endif
@@ -21,11 +21,14 @@
 #include <algorithm>
 #include <cassert>
 #include <deque>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string_view>
 #include <utility>
 #include <vector>
 
+#include "benchmark.h"
 #include "evaluate.h"
 #include "misc.h"
 #include "nnue/network.h"
@@ -43,6 +46,15 @@ namespace Stockfish {
 
 namespace NN = Eval::NNUE;
 
+namespace {
+
+// Networks left behind by Engine::stash_networks(), consumed by the next Engine.
+// An owner of the allocation of the networks, not a copy of them.
+std::mutex                                              stashedNetworksMutex;
+std::unique_ptr<SystemWideSharedConstant<NN::Networks>> stashedNetworks;
+
+}
+
 constexpr auto StartFEN   = "rnbakabnr/9/1c5c1/p1p1p1p1p/9/9/P1P1P1P1P/1C5C1/9/RNBAKABNR w";
 constexpr int  MaxHashMB  = Is64Bit ? 33554432 : 2048;
 int            MaxThreads = std::max(1024, 4 * int(get_hardware_concurrency()));
@@ -52,10 +64,7 @@ Engine::Engine(std::optional<std::string> path) :
     numaContext(NumaConfig::from_system()),
     states(new std::deque<StateInfo>(1)),
     threads(),
-    networks(numaContext,
-             // Heap-allocate because sizeof(NN::Networks) is large
-             std::make_unique<NN::Networks>(std::make_unique<NN::NetworkBig>(
-               NN::EvalFile{EvalFileDefaultNameBig, "None", ""}))) {
+    networks(numaContext, *take_stashed_networks()) {
 
     pos.set(StartFEN, &states->back());
 
@@ -80,8 +89,7 @@ Engine::Engine(std::optional<std::string> path) :
 
     options.add(  //
       "Hash", Option(16, 1, MaxHashMB, [this](const Option& o) {
-          set_tt_size(o);
-          return std::nullopt;
+          return set_tt_size(o);
       }));
 
     options.add(  //
@@ -90,18 +98,35 @@ Engine::Engine(std::optional<std::string> path) :
           return std::nullopt;
       }));
 
+    // Per thread, in MB. Off by default, as its hit rate in search is low
+    options.add("Eval Cache", Option(0, 0, 256));
+
     options.add(  //
       "Ponder", Option(false));
 
     options.add(  //
       "MultiPV", Option(1, 1, MAX_MOVES));
 
+    options.add("Skill Level", Option(20, 0, 20));
+
     options.add("Move Overhead", Option(10, 0, 5000));
 
     options.add("nodestime", Option(0, 0, 10000));
 
+    options.add("UCI_LimitStrength", Option(false));
+
+    // Approximate: mapped to a Skill Level as chess Stockfish does, not
+    // calibrated against xiangqi ratings. See Search::Skill.
+    options.add("UCI_Elo", Option(Search::Skill::LowestElo, Search::Skill::LowestElo,
+                                  Search::Skill::HighestElo));
+
     options.add("UCI_ShowWDL", Option(false));
 
+    // Directory for network cache files, used from the next network load on.
+    // Empty for no cache. See set_network_cache_directory().
+    options.add(  //
+      "EvalFileCache", Option(NN::network_cache_directory().c_str()));
+
     options.add(  //
       "EvalFile", Option(EvalFileDefaultNameBig, [this](const Option& o) {
           load_big_network(o);
@@ -112,11 +137,27 @@ Engine::Engine(std::optional<std::string> path) :
     resize_threads();
 }
 
-std::uint64_t Engine::perft(const std::string& fen, Depth depth) {
+Benchmark::PerftResult Engine::perft(const std::string& fen, Depth depth) {
     verify_networks();
+    wait_for_search_finished();
+
+    return Benchmark::perft(fen, depth, threads, size_t(options["Hash"]));
+}
+
+std::vector<Benchmark::MicrobenchResult> Engine::microbench(int runs) {
+    verify_networks();
+    wait_for_search_finished();
+
+    return Benchmark::microbench(*networks, tt, runs);
+}
+
+#if defined(USE_FT_INT8)
+std::string Engine::compare_ft_weights(int runs) {
+    wait_for_search_finished();
 
-    return Benchmark::perft(fen, depth);
+    return Benchmark::compare_ft_weights(*networks, binaryDirectory, options["EvalFile"], runs);
 }
+#endif
 
 void Engine::go(Search::LimitsType& limits) {
     assert(limits.perft == 0);
@@ -124,7 +165,10 @@ void Engine::go(Search::LimitsType& limits) {
 
     threads.start_thinking(pos, states, limits);
 }
-void Engine::stop() { threads.stop = true; }
+void Engine::stop() {
+    threads.stop = true;
+    threads.main_manager()->notify_stop_or_ponderhit();
+}
 
 void Engine::search_clear() {
     wait_for_search_finished();
@@ -153,6 +197,14 @@ void Engine::set_on_verify_networks(std::function<void(std::string_view)>&& f) {
     onVerifyNetworks = std::move(f);
 }
 
+void Engine::set_on_update_full_binary(std::function<void(const Engine::InfoBinary&)>&& f) {
+    updateContext.onUpdateFullBinary = std::move(f);
+}
+
+void Engine::set_on_bestmove_binary(std::function<void(Move, Move)>&& f) {
+    updateContext.onBestmoveBinary = std::move(f);
+}
+
 void Engine::wait_for_search_finished() { threads.main_thread()->wait_for_search_finished(); }
 
 void Engine::set_position(const std::string& fen, const std::vector<std::string>& moves) {
@@ -172,6 +224,49 @@ void Engine::set_position(const std::string& fen, const std::vector<std::string>
     }
 }
 
+size_t Engine::append_moves(const std::vector<std::string>& moves) {
+    reclaim_states();
+
+    size_t played = 0;
+    for (const auto& move : moves)
+    {
+        auto m = UCIEngine::to_move(pos, move);
+
+        if (m == Move::none())
+            break;
+
+        states->emplace_back();
+        pos.do_move(m, states->back());
+        ++played;
+    }
+
+    return played;
+}
+
+size_t Engine::undo_moves(size_t plies) {
+    reclaim_states();
+
+    size_t undone = 0;
+    while (undone < plies && states->size() > 1)
+    {
+        pos.undo_move(states->back().move);
+        states->pop_back();
+        ++undone;
+    }
+
+    return undone;
+}
+
+// The last search took ownership of the state list, take it back so that the
+// position can be updated in place. The search must not be running.
+void Engine::reclaim_states() {
+    stop();
+    wait_for_search_finished();
+
+    if (!states)
+        states = threads.release_setup_states();
+}
+
 // modifiers
 
 void Engine::set_numa_config_from_option(const std::string& o) {
@@ -207,12 +302,46 @@ void Engine::resize_threads() {
     threads.ensure_network_replicated();
 }
 
-void Engine::set_tt_size(size_t mb) {
+std::string Engine::set_tt_size(size_t mb) {
     wait_for_search_finished();
-    tt.resize(mb, threads);
+
+    const TimePoint start = now();
+    const size_t    kept  = tt.resize(mb, threads);
+
+    return "Hash resized to " + std::to_string(mb) + " MB in " + std::to_string(now() - start)
+         + " ms, " + std::to_string(kept) + " entries kept";
 }
 
-void Engine::set_ponderhit(bool b) { threads.main_manager()->ponder = b; }
+// Hash keys of a saved table are only meaningful to a build with the same
+// Zobrist keys, which the key of the start position identifies
+static Key tt_fingerprint() {
+    StateInfo st;
+    Position  p;
+    p.set(StartFEN, &st);
+    return p.key();
+}
+
+std::optional<std::string> Engine::save_tt(const std::string& file) {
+    wait_for_search_finished();
+    return tt.save(file, tt_fingerprint());
+}
+
+std::optional<std::string> Engine::load_tt(const std::string& file) {
+    wait_for_search_finished();
+
+    auto error = tt.load(file, tt_fingerprint());
+
+    // Show the size of the loaded table without reallocating it
+    if (!error)
+        options.options_map["Hash"].currentValue = std::to_string(tt.size_mb());
+
+    return error;
+}
+
+void Engine::set_ponderhit(bool b) {
+    threads.main_manager()->ponder = b;
+    threads.main_manager()->notify_stop_or_ponderhit();
+}
 
 // network related
 
@@ -250,21 +379,43 @@ void Engine::verify_networks() const {
     }
 }
 
-void Engine::load_networks() {
-    networks.modify_and_replicate([this](NN::Networks& networks_) {
-        networks_.big.load(binaryDirectory, options["EvalFile"]);
-    });
-    threads.clear();
-    threads.ensure_network_replicated();
-}
+void Engine::load_networks() { load_big_network(options["EvalFile"]); }
 
 void Engine::load_big_network(const std::string& file) {
-    networks.modify_and_replicate(
-      [this, &file](NN::Networks& networks_) { networks_.big.load(binaryDirectory, file); });
+    // Network::load() skips a file that is already loaded, so copying the
+    // networks to load into would only cost a second copy of them for a while
+    if (!networks->big.is_loaded(file))
+        networks.modify_and_replicate([this, &file](NN::Networks& networks_) {
+            networks_.big.load(binaryDirectory, file, options["EvalFileCache"]);
+        });
     threads.clear();
     threads.ensure_network_replicated();
 }
 
+void Engine::stash_networks() const {
+    auto shared = std::make_unique<SystemWideSharedConstant<NN::Networks>>(networks.share());
+
+    std::lock_guard<std::mutex> lock(stashedNetworksMutex);
+    stashedNetworks = std::move(shared);
+}
+
+std::shared_ptr<const NN::Networks> Engine::take_stashed_networks() {
+    {
+        std::lock_guard<std::mutex> lock(stashedNetworksMutex);
+        if (stashedNetworks)
+        {
+            // Kept alive until the networks of the new Engine share its allocation
+            std::shared_ptr<const SystemWideSharedConstant<NN::Networks>> stashed =
+              std::move(stashedNetworks);
+            return std::shared_ptr<const NN::Networks>(stashed, &**stashed);
+        }
+    }
+
+    // Heap-allocate because sizeof(NN::Networks) is large
+    return std::make_unique<NN::Networks>(
+      std::make_unique<NN::NetworkBig>(NN::EvalFile{EvalFileDefaultNameBig, "None", ""}));
+}
+
 void Engine::save_network(const std::pair<std::optional<std::string>, std::string> files) {
     networks.modify_and_replicate(
       [&files](NN::Networks& networks_) { networks_.big.save(files.first); });
@@ -297,6 +448,16 @@ std::string Engine::visualize() const {
 
 int Engine::get_hashfull(int maxAge) const { return tt.hashfull(maxAge); }
 
+uint64_t Engine::get_idle_wakeups() { return threads.main_manager()->idleWakeups; }
+
+std::pair<uint64_t, uint64_t> Engine::get_chase_cache_stats() const {
+    return threads.chase_cache_stats();
+}
+
+std::pair<uint64_t, uint64_t> Engine::get_eval_cache_stats() const {
+    return threads.eval_cache_stats();
+}
+
 std::vector<std::pair<size_t, size_t>> Engine::get_bound_thread_count_by_numa_node() const {
     auto                                   counts = threads.get_bound_thread_count_by_numa_node();
     const NumaConfig&                      cfg    = numaContext.get_numa_config();
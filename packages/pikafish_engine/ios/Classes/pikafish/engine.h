@@ -22,6 +22,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -39,11 +40,17 @@
 
 namespace Stockfish {
 
+namespace Benchmark {
+struct PerftResult;
+struct MicrobenchResult;
+}
+
 class Engine {
    public:
-    using InfoShort = Search::InfoShort;
-    using InfoFull  = Search::InfoFull;
-    using InfoIter  = Search::InfoIteration;
+    using InfoShort  = Search::InfoShort;
+    using InfoFull   = Search::InfoFull;
+    using InfoIter   = Search::InfoIteration;
+    using InfoBinary = Search::InfoFullBinary;
 
     Engine(std::optional<std::string> path = std::nullopt);
 
@@ -55,7 +62,12 @@ class Engine {
 
     ~Engine() { wait_for_search_finished(); }
 
-    std::uint64_t perft(const std::string& fen, Depth depth);
+    Benchmark::PerftResult                   perft(const std::string& fen, Depth depth);
+    std::vector<Benchmark::MicrobenchResult> microbench(int runs);
+#if defined(USE_FT_INT8)
+    // int8 against int16 feature transformer weights of the EvalFile network
+    std::string compare_ft_weights(int runs);
+#endif
 
     // non blocking call to start searching
     void go(Search::LimitsType&);
@@ -66,12 +78,24 @@ class Engine {
     void wait_for_search_finished();
     // set a new position, moves are in UCI format
     void set_position(const std::string& fen, const std::vector<std::string>& moves);
+    // play moves in UCI format on top of the current position, keeping its
+    // history for repetition and chase detection. Stops a running search.
+    // Returns the number of moves played, up to the first illegal one.
+    size_t append_moves(const std::vector<std::string>& moves);
+    // take back up to 'plies' moves played since the last set_position().
+    // Stops a running search. Returns the number of moves taken back.
+    size_t undo_moves(size_t plies);
 
     // modifiers
 
     void set_numa_config_from_option(const std::string& o);
     void resize_threads();
-    void set_tt_size(size_t mb);
+    // resize the hash, keeping its entries, and describe how long it took
+    std::string set_tt_size(size_t mb);
+    // write the transposition table to a file, or map one written earlier in
+    // its place. Both wait for the search to finish and return an error, if any
+    std::optional<std::string> save_tt(const std::string& file);
+    std::optional<std::string> load_tt(const std::string& file);
     void set_ponderhit(bool);
     void search_clear();
 
@@ -80,6 +104,9 @@ class Engine {
     void set_on_iter(std::function<void(const InfoIter&)>&&);
     void set_on_bestmove(std::function<void(std::string_view, std::string_view)>&&);
     void set_on_verify_networks(std::function<void(std::string_view)>&&);
+    // binary listeners replace the text ones above when set, pass nullptr to unset
+    void set_on_update_full_binary(std::function<void(const InfoBinary&)>&&);
+    void set_on_bestmove_binary(std::function<void(Move, Move)>&&);
 
     // network related
 
@@ -87,6 +114,10 @@ class Engine {
     void load_networks();
     void load_big_network(const std::string& file);
     void save_network(const std::pair<std::optional<std::string>, std::string> files);
+    // hand the loaded networks over to the next Engine constructed in this
+    // process, which then skips reading and decompressing an unchanged EvalFile.
+    // The networks are shared, not copied.
+    void stash_networks() const;
 
     // utility functions
 
@@ -97,6 +128,14 @@ class Engine {
 
     int get_hashfull(int maxAge = 0) const;
 
+    // times the main thread woke up while parked after a ponder/infinite search
+    uint64_t get_idle_wakeups();
+
+    // Hits and misses of the per-thread perpetual chase verdict caches
+    std::pair<uint64_t, uint64_t> get_chase_cache_stats() const;
+    // Hits and misses of the per-thread network output caches
+    std::pair<uint64_t, uint64_t> get_eval_cache_stats() const;
+
     std::string                            fen() const;
     void                                   flip();
     std::string                            visualize() const;
@@ -121,6 +160,10 @@ class Engine {
 
     Search::SearchManager::UpdateContext  updateContext;
     std::function<void(std::string_view)> onVerifyNetworks;
+
+    void reclaim_states();
+
+    static std::shared_ptr<const Eval::NNUE::Networks> take_stashed_networks();
 };
 
 }  // namespace Stockfish
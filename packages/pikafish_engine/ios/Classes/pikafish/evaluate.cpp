@@ -21,11 +21,13 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
 #include <iomanip>
 #include <memory>
 #include <sstream>
 #include <tuple>
 
+#include "misc.h"
 #include "nnue/network.h"
 #include "nnue/nnue_misc.h"
 #include "position.h"
@@ -35,17 +37,87 @@
 
 namespace Stockfish {
 
+void Eval::EvalCache::resize(size_t mbSize) {
+
+    if (mbSize == sizeMb)
+        return;
+
+    sizeMb      = mbSize;
+    bucketCount = mbSize * 1024 * 1024 / sizeof(Bucket);
+    table       = bucketCount ? make_unique_aligned<Bucket[]>(bucketCount) : nullptr;
+    clear();
+}
+
+void Eval::EvalCache::clear() {
+
+    if (table)
+        std::memset(static_cast<void*>(table.get()), 0, bucketCount * sizeof(Bucket));
+    hits = misses = 0;
+}
+
+bool Eval::EvalCache::probe(Key key, Value& psqt, Value& positional) {
+
+    if (!bucketCount)
+        return false;
+
+    const Bucket&  b     = table[mul_hi64(key, bucketCount)];
+    const uint32_t key32 = uint32_t(key);
+
+    for (const Entry& e : b.entry)
+        if (e.key32 == key32)
+        {
+            ++hits;
+            psqt       = e.psqt;
+            positional = e.positional;
+            return true;
+        }
+
+    ++misses;
+    return false;
+}
+
+void Eval::EvalCache::store(Key key, Value psqt, Value positional) {
+
+    // Outputs that do not fit the entry are rare enough to just be recomputed
+    if (!bucketCount || psqt != int16_t(psqt) || positional != int16_t(positional))
+        return;
+
+    Bucket&        b     = table[mul_hi64(key, bucketCount)];
+    const uint32_t key32 = uint32_t(key);
+
+    // A bucket keeps its entries newest first. The entry of the same key, or
+    // else the oldest one, makes way for the new entry at the front.
+    int i = 0;
+    while (i < BucketSize - 1 && b.entry[i].key32 != key32)
+        ++i;
+
+    std::memmove(static_cast<void*>(&b.entry[1]), &b.entry[0], i * sizeof(Entry));
+    b.entry[0] = {key32, int16_t(psqt), int16_t(positional)};
+}
+
 // Evaluate is the evaluator for the outer world. It returns a static evaluation
 // of the position from the point of view of the side to move.
 Value Eval::evaluate(const Eval::NNUE::Networks&    networks,
                      const Position&                pos,
                      Eval::NNUE::AccumulatorStack&  accumulators,
                      Eval::NNUE::AccumulatorCaches& caches,
-                     int                            optimism) {
+                     int                            optimism,
+                     Eval::EvalCache*               evalCache) {
 
     assert(!pos.checkers());
 
-    auto [psqt, positional] = networks.big.evaluate(pos, accumulators, &caches.big);
+    // The network sees neither the rule60 counter nor repetitions, so look up
+    // the plain key. A hit leaves this ply's accumulator uncomputed, which the
+    // accumulator stack catches up on lazily, as after a TT eval hit.
+    const Key key = pos.state()->key;
+    Value     psqt, positional;
+
+    if (!evalCache || !evalCache->probe(key, psqt, positional))
+    {
+        std::tie(psqt, positional) = networks.big.evaluate(pos, accumulators, &caches.big);
+        if (evalCache)
+            evalCache->store(key, psqt, positional);
+    }
 
     Value nnue = psqt + positional;
 
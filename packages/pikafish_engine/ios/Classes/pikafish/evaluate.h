@@ -19,8 +19,11 @@
 #ifndef EVALUATE_H_INCLUDED
 #define EVALUATE_H_INCLUDED
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
+#include "memory.h"
 #include "types.h"
 
 namespace Stockfish {
@@ -41,13 +44,47 @@ struct AccumulatorCaches;
 class AccumulatorStack;
 }
 
+// EvalCache is a per-thread hash of network outputs, so that a position met
+// again, whose TT entry was replaced or holds no eval, skips the accumulator
+// update and the layer stack. Each bucket fills a cache line; the upper bits
+// of the position key select the bucket and its lower 32 bits are stored.
+class EvalCache {
+    static constexpr int BucketSize = 8;
+
+    struct Entry {
+        uint32_t key32;
+        int16_t  psqt;
+        int16_t  positional;
+    };
+
+    struct alignas(64) Bucket {
+        Entry entry[BucketSize];
+    };
+
+   public:
+    // Size in MB, 0 disables the cache. Clears it if the size changed.
+    void resize(size_t mbSize);
+    void clear();
+
+    bool probe(Key key, Value& psqt, Value& positional);
+    void store(Key key, Value psqt, Value positional);
+
+    uint64_t hits = 0, misses = 0;
+
+   private:
+    AlignedPtr<Bucket[]> table;
+    size_t               bucketCount = 0;
+    size_t               sizeMb      = 0;
+};
+
 std::string trace(Position& pos, const Eval::NNUE::Networks& networks);
 
 Value evaluate(const NNUE::Networks&          networks,
                const Position&                pos,
                Eval::NNUE::AccumulatorStack&  accumulators,
                Eval::NNUE::AccumulatorCaches& caches,
-               int                            optimism);
+               int                            optimism,
+               EvalCache*                     evalCache = nullptr);
 }  // namespace Eval
 
 }  // namespace Stockfish
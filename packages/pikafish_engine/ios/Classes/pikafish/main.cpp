@@ -30,4 +30,20 @@ int pikafish_main(int argc, char* argv[]) {
     uci->loop();
 
     return 0;
-}
\ No newline at end of file
+}
+
+#ifdef DISPATCH_TARGET
+// Entry points of this copy of the engine in a 'make dispatch' build, suffixed
+// with its arch so that dispatch.cpp can pick one copy at startup.
+    #define DISPATCH_CONCAT(name, target) name##target
+    #define DISPATCH_NAME(name, target) DISPATCH_CONCAT(name, target)
+    #define pikafish_main_target DISPATCH_NAME(pikafish_main_, DISPATCH_TARGET)
+    #define uci_inject_command_target DISPATCH_NAME(uci_inject_command_, DISPATCH_TARGET)
+
+extern "C" int  pikafish_main_target(int argc, char* argv[]);
+extern "C" void uci_inject_command_target(const char* cmd);
+
+extern "C" int pikafish_main_target(int argc, char* argv[]) { return pikafish_main(argc, argv); }
+
+extern "C" void uci_inject_command_target(const char* cmd) { uci_inject_command(cmd); }
+#endif
@@ -28,6 +28,13 @@
     #include <sys/mman.h>
 #endif
 
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
 #if defined(__APPLE__) || defined(__ANDROID__) || defined(__OpenBSD__) \
   || (defined(__GLIBCXX__) && !defined(_GLIBCXX_HAVE_ALIGNED_ALLOC) && !defined(_WIN32)) \
   || defined(__e2k__)
@@ -195,5 +202,74 @@ void aligned_large_pages_free(void* mem) {
 
 void aligned_large_pages_free(void* mem) { std_aligned_free(mem); }
 
+#endif
+
+
+// map_file() maps the file privately: the pages are read from the file on
+// first access only, and a modified page becomes an anonymous copy.
+
+#if defined(_WIN32)
+
+void* map_file(const std::string& path, size_t& size) {
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    LARGE_INTEGER fileSize;
+    void*         mem = nullptr;
+
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+    {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        if (mapping)
+        {
+            mem  = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+            size = size_t(fileSize.QuadPart);
+            CloseHandle(mapping);
+        }
+    }
+
+    CloseHandle(file);
+    return mem;
+}
+
+void unmap_file(void* mem, size_t) {
+
+    if (mem)
+        UnmapViewOfFile(mem);
+}
+
+#else
+
+void* map_file(const std::string& path, size_t& size) {
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return nullptr;
+
+    struct stat st;
+    void*       mem = nullptr;
+
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        mem = mmap(nullptr, size_t(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (mem == MAP_FAILED)
+            mem = nullptr;
+        else
+            size = size_t(st.st_size);
+    }
+
+    close(fd);
+    return mem;
+}
+
+void unmap_file(void* mem, size_t size) {
+
+    if (mem)
+        munmap(mem, size);
+}
+
 #endif
 }  // namespace Stockfish
@@ -24,6 +24,7 @@
 #include <cstdint>
 #include <memory>
 #include <new>
+#include <string>
 #include <type_traits>
 #include <utility>
 
@@ -63,6 +64,12 @@ void  aligned_large_pages_free(void* mem);
 
 bool has_large_pages();
 
+// Maps a whole file copy-on-write, so writes to the memory never reach the
+// file. Returns nullptr on failure, otherwise the page aligned mapping and its
+// size, which must be released with unmap_file().
+void* map_file(const std::string& path, size_t& size);
+void  unmap_file(void* mem, size_t size);
+
 // Frees memory which was placed there with placement new.
 // Works for both single objects and arrays of unknown bound.
 template<typename T, typename FREE_FUNC>
@@ -236,6 +236,11 @@ std::string compiler_info() {
     compiler += "(undefined architecture)";
 #endif
 
+#if defined(DISPATCH_ARCHS)
+    compiler += "\nRuntime dispatch           : picked at startup from ";
+    compiler += stringify(DISPATCH_ARCHS);
+#endif
+
     compiler += "\nCompilation settings       : ";
     compiler += (Is64Bit ? "64bit" : "32bit");
 #if defined(USE_AVX512ICL)
@@ -270,6 +275,10 @@ std::string compiler_info() {
     compiler += " NEON";
 #endif
 
+#if defined(USE_FT_INT8)
+    compiler += " FT_INT8";
+#endif
+
 #if !defined(NDEBUG)
     compiler += " DEBUG";
 #endif
@@ -527,38 +536,83 @@ std::string CommandLine::get_working_directory() {
     return workingDirectory;
 }
 
-std::stringstream read_compressed_nnue(const std::string& fpath) {
-    std::stringstream ss;
+NetworkReadBuf::NetworkReadBuf(const void* data, size_t size) :
+    in(static_cast<const char*>(data)),
+    inSize(size) {
+
+    // The frame magic number is stored little-endian
+    std::uint32_t magic = 0;
+    for (size_t i = 0; i < 4 && i < size; ++i)
+        magic |= std::uint32_t(std::uint8_t(in[i])) << (8 * i);
 
-    std::ifstream fin(fpath, std::ios::binary);
-    if (!fin)
-        return ss;
-    std::vector<char> buffIn(ZSTD_DStreamInSize()), buffOut(ZSTD_DStreamOutSize());
-    auto              dctxDeleter = [&](auto* p) {
-        if (p)
-            ZSTD_freeDCtx(p);
-    };
-    std::unique_ptr<ZSTD_DCtx, decltype(dctxDeleter)> dctx = {ZSTD_createDCtx(), dctxDeleter};
-    if (!dctx)
-        return ss;
-
-    while (fin.read(buffIn.data(), buffIn.size()) || fin.gcount() > 0)
+    if (magic == ZSTD_MAGICNUMBER)
     {
-        size_t        read  = static_cast<size_t>(fin.gcount());
-        ZSTD_inBuffer input = {buffIn.data(), read, 0};
+        dctx = ZSTD_createDCtx();
+        window.resize(ZSTD_DStreamOutSize());
+        finished = !dctx;
+    }
+    else
+    {
+        // Not compressed, the get area is the whole buffer
+        char* begin = const_cast<char*>(in);
+        setg(begin, begin, begin + size);
+        finished = true;
+    }
+}
 
-        while (input.pos < input.size)
-        {
-            ZSTD_outBuffer output = {buffOut.data(), buffOut.size(), 0};
-            size_t const   ret    = ZSTD_decompressStream(dctx.get(), &output, &input);
-            if (ZSTD_isError(ret))
-                return ss;
+NetworkReadBuf::~NetworkReadBuf() { ZSTD_freeDCtx(dctx); }
 
-            ss.write(buffOut.data(), output.pos);
-        }
+// Decompresses up to 'size' bytes into 'out' and returns how many were written,
+// less than 'size' only at the end of the input or on a decompression error.
+size_t NetworkReadBuf::decompress(char* out, size_t size) {
+    ZSTD_outBuffer output = {out, size, 0};
+
+    while (output.pos < output.size && !finished)
+    {
+        ZSTD_inBuffer input = {in, inSize, inPos};
+        size_t const  ret   = ZSTD_decompressStream(dctx, &output, &input);
+        inPos               = input.pos;
+
+        // With the input consumed, an output buffer left with room means that
+        // everything was flushed, or that the input is truncated.
+        finished = ZSTD_isError(ret) || (inPos == inSize && output.pos < output.size);
+    }
+
+    return output.pos;
+}
+
+NetworkReadBuf::int_type NetworkReadBuf::underflow() {
+    if (gptr() == egptr())
+    {
+        const size_t n = decompress(window.data(), window.size());
+        if (!n)
+            return traits_type::eof();
+
+        setg(window.data(), window.data(), window.data() + n);
+    }
+    return traits_type::to_int_type(*gptr());
+}
+
+std::streamsize NetworkReadBuf::xsgetn(char* s, std::streamsize n) {
+    const size_t wanted = size_t(n);
+    size_t       copied = std::min(wanted, size_t(egptr() - gptr()));
+
+    std::memcpy(s, gptr(), copied);
+    setg(eback(), gptr() + copied, egptr());
+
+    // A read larger than the window skips it
+    if (wanted - copied >= window.size() && !finished)
+        copied += decompress(s + copied, wanted - copied);
+
+    while (copied < wanted && underflow() != traits_type::eof())
+    {
+        const size_t chunk = std::min(wanted - copied, size_t(egptr() - gptr()));
+        std::memcpy(s + copied, gptr(), chunk);
+        setg(eback(), gptr() + chunk, egptr());
+        copied += chunk;
     }
 
-    return ss;
+    return std::streamsize(copied);
 }
 
 }  // namespace Stockfish
@@ -32,11 +32,14 @@
 #include <optional>
 #include <cstring>
 #include <memory>
+#include <streambuf>
 #include <string>
 #include <string_view>
 #include <type_traits>
 #include <vector>
 
+struct ZSTD_DCtx_s;
+
 #define stringify2(x) #x
 #define stringify(x) stringify2(x)
 
@@ -55,7 +58,31 @@ void start_logger(const std::string& fname);
 
 size_t str_to_size_t(const std::string& s);
 
-std::stringstream read_compressed_nnue(const std::string& fpath);
+// Stream buffer over a network file held in memory, for example a mapped
+// file. A zstd compressed file is decompressed on the fly through a window of
+// ZSTD_DStreamOutSize() bytes, and large reads are decompressed directly into
+// the caller's buffer. Anything else is read in place.
+class NetworkReadBuf: public std::streambuf {
+   public:
+    NetworkReadBuf(const void* data, size_t size);
+    ~NetworkReadBuf() override;
+
+    NetworkReadBuf(const NetworkReadBuf&)            = delete;
+    NetworkReadBuf& operator=(const NetworkReadBuf&) = delete;
+
+   protected:
+    int_type        underflow() override;
+    std::streamsize xsgetn(char* s, std::streamsize n) override;
+
+   private:
+    size_t decompress(char* out, size_t size);
+
+    ZSTD_DCtx_s*      dctx = nullptr;
+    const char*       in;
+    size_t            inSize, inPos = 0;
+    bool              finished = false;
+    std::vector<char> window;
+};
 
 #if defined(__linux__)
 
@@ -75,11 +75,11 @@ inline Move* splat_moves(Move* moveList, Square from, Bitboard to_bb) {
 #endif
 
 template<Color Us, PieceType Pt, GenType Type>
-Move* generate_moves(const Position& pos, Move* moveList, Bitboard target) {
+Move* generate_moves(const Position& pos, Move* moveList, Bitboard target, Bitboard movers) {
 
     static_assert(Pt != KING, "Unsupported piece type in generate_moves()");
 
-    Bitboard bb = pos.pieces(Us, Pt);
+    Bitboard bb = pos.pieces(Us, Pt) & movers;
 
     while (bb)
     {
@@ -98,8 +98,8 @@ Move* generate_moves(const Position& pos, Move* moveList, Bitboard target) {
             if (Type != CAPTURES)
                 b |= attacks_bb<ROOK>(from, pos.pieces()) & ~pos.pieces();
 
-            // Restrict to target if in evasion generation
-            if (Type == EVASIONS)
+            // Restrict to target if in evasion or legal generation
+            if (Type == EVASIONS || Type == LEGAL)
                 b &= target;
         }
 
@@ -110,13 +110,16 @@ Move* generate_moves(const Position& pos, Move* moveList, Bitboard target) {
 }
 
 template<Color Us, GenType Type>
-Move* generate_moves(const Position& pos, Move* moveList, Bitboard target) {
-    moveList = generate_moves<Us, PAWN, Type>(pos, moveList, target);
-    moveList = generate_moves<Us, BISHOP, Type>(pos, moveList, target);
-    moveList = generate_moves<Us, ADVISOR, Type>(pos, moveList, target);
-    moveList = generate_moves<Us, KNIGHT, Type>(pos, moveList, target);
-    moveList = generate_moves<Us, CANNON, Type>(pos, moveList, target);
-    moveList = generate_moves<Us, ROOK, Type>(pos, moveList, target);
+Move* generate_moves(const Position& pos,
+                     Move*           moveList,
+                     Bitboard        target,
+                     Bitboard        movers = ~Bitboard(0)) {
+    moveList = generate_moves<Us, PAWN, Type>(pos, moveList, target, movers);
+    moveList = generate_moves<Us, BISHOP, Type>(pos, moveList, target, movers);
+    moveList = generate_moves<Us, ADVISOR, Type>(pos, moveList, target, movers);
+    moveList = generate_moves<Us, KNIGHT, Type>(pos, moveList, target, movers);
+    moveList = generate_moves<Us, CANNON, Type>(pos, moveList, target, movers);
+    moveList = generate_moves<Us, ROOK, Type>(pos, moveList, target, movers);
     return moveList;
 }
 
@@ -140,6 +143,106 @@ Move* generate_all(const Position& pos, Move* moveList) {
     return moveList;
 }
 
+// Removes the moves which leave the king of Us attacked. A checker on the
+// destination square is captured by the move.
+template<Color Us>
+Move* remove_exposing(const Position& pos, Move* cur, Move* end) {
+
+    const Square ksq = pos.king_square(Us);
+
+    while (cur != end)
+    {
+        Square   from     = cur->from_sq();
+        Square   to       = cur->to_sq();
+        Bitboard occupied = (pos.pieces() ^ from) | to;
+
+        if (pos.checkers_to(~Us, from == ksq ? to : ksq, occupied) & ~square_bb(to))
+            *cur = *(--end);
+        else
+            ++cur;
+    }
+
+    return end;
+}
+
+template<Color Us>
+Move* generate_legal(const Position& pos, Move* moveList) {
+
+    assert(!pos.checkers());
+
+    const Square ksq = pos.king_square(Us);
+
+    // Pieces whose move can uncover the king: the only piece between it and
+    // a rook or the other king, a knight leg, or one of two cannon screens.
+    const Bitboard pinned = pos.blockers_for_king(Us) & pos.pieces(Us);
+
+    // Any other move is legal unless it fills the empty line between the king
+    // and a cannon, which would give the cannon its screen.
+    Bitboard target  = ~pos.pieces(Us);
+    Bitboard cannons = attacks_bb<ROOK>(ksq) & pos.pieces(~Us, CANNON);
+    while (cannons)
+    {
+        Square   s      = pop_lsb(cannons);
+        Bitboard screen = between_bb(ksq, s) ^ s;
+        if (!(screen & pos.pieces()))
+            target &= ~screen;
+    }
+
+    moveList = generate_moves<Us, LEGAL>(pos, moveList, target, ~pinned);
+
+    // Pinned pieces and the king are checked move by move
+    Move* cur = moveList;
+    moveList  = generate_moves<Us, PSEUDO_LEGAL>(pos, moveList, ~pos.pieces(Us), pinned);
+    moveList  = splat_moves(moveList, ksq, attacks_bb<KING>(ksq) & ~pos.pieces(Us));
+
+    return remove_exposing<Us>(pos, cur, moveList);
+}
+
+// Evasions of more than one checker. A move other than the king's must answer
+// every check at once: capture each checker or block its line, except that a
+// cannon's check is also answered by moving its screen away. Only such moves
+// are generated, and each is then verified.
+template<Color Us>
+Move* generate_multi_evasions(const Position& pos, Move* moveList) {
+
+    assert(more_than_one(pos.checkers()));
+
+    const Square ksq     = pos.king_square(Us);
+    Bitboard     target  = ~pos.pieces(Us);
+    Bitboard     screens = 0;
+
+    for (Bitboard b = pos.checkers(); b;)
+    {
+        Square s = pop_lsb(b);
+        target &= between_bb(ksq, s);
+        if (type_of(pos.piece_on(s)) == CANNON)
+            screens |= between_bb(ksq, s) & pos.pieces(Us);
+    }
+
+    Move* cur = moveList;
+    moveList  = generate_moves<Us, EVASIONS>(pos, moveList, target, ~screens);
+
+    // A screen has to answer only the checks of the other checkers
+    while (screens)
+    {
+        Square   screen       = pop_lsb(screens);
+        Bitboard screenTarget = ~pos.pieces(Us);
+
+        for (Bitboard b = pos.checkers(); b;)
+        {
+            Square s = pop_lsb(b);
+            if (!(between_bb(ksq, s) & screen))
+                screenTarget &= between_bb(ksq, s);
+        }
+
+        moveList = generate_moves<Us, EVASIONS>(pos, moveList, screenTarget, square_bb(screen));
+    }
+
+    moveList = splat_moves(moveList, ksq, attacks_bb<KING>(ksq) & ~pos.pieces(Us));
+
+    return remove_exposing<Us>(pos, cur, moveList);
+}
+
 }  // namespace
 
 
@@ -219,23 +322,29 @@ Move* generate<EVASIONS>(const Position& pos, Move* moveList) {
 }
 
 
-// generate<LEGAL> generates all the legal moves in the given position
+// generate<LEGAL> generates all the legal moves in the given position, without
+// testing each pseudo-legal move with Position::legal().
 
 template<>
 Move* generate<LEGAL>(const Position& pos, Move* moveList) {
 
-    Move* cur = moveList;
+    Color us = pos.side_to_move();
 
-    moveList =
-      pos.checkers() ? generate<EVASIONS>(pos, moveList) : generate<PSEUDO_LEGAL>(pos, moveList);
+    if (more_than_one(pos.checkers()))
+        return us == WHITE ? generate_multi_evasions<WHITE>(pos, moveList)
+                           : generate_multi_evasions<BLACK>(pos, moveList);
 
-    while (cur != moveList)
-        if (!pos.legal(*cur))
-            *cur = *(--moveList);
-        else
-            ++cur;
+    // In check any evasion may open another line or complete a cannon
+    // screen, so each one is verified.
+    if (pos.checkers())
+    {
+        Move* end = generate<EVASIONS>(pos, moveList);
+        return us == WHITE ? remove_exposing<WHITE>(pos, moveList, end)
+                           : remove_exposing<BLACK>(pos, moveList, end);
+    }
 
-    return moveList;
+    return us == WHITE ? generate_legal<WHITE>(pos, moveList)
+                       : generate_legal<BLACK>(pos, moveList);
 }
 
 }  // namespace Stockfish
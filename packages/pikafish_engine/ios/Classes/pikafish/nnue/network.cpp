@@ -18,13 +18,18 @@
 
 #include "network.h"
 
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <sstream>
 #include <optional>
 #include <vector>
 
+#include "../memory.h"
 #include "../misc.h"
 #include "../types.h"
 #include "nnue_architecture.h"
@@ -34,6 +39,109 @@
 namespace Stockfish::Eval::NNUE {
 
 
+namespace {
+
+std::mutex                                                networkBuffersMutex;
+std::map<std::string, std::pair<const void*, std::size_t>> networkBuffers;
+
+std::optional<std::pair<const void*, std::size_t>> find_network_buffer(const std::string& name) {
+    std::lock_guard<std::mutex> lock(networkBuffersMutex);
+
+    const auto it = networkBuffers.find(name);
+    if (it == networkBuffers.end())
+        return std::nullopt;
+    return it->second;
+}
+
+std::mutex  networkCacheDirectoryMutex;
+std::string networkCacheDirectory;
+
+// With a cache directory, a loaded network is also written there as a cache
+// file: a page with this header, then the image of the Network object, with
+// the weights already decoded and permuted for the SIMD code of this build.
+// Later loads of the same file read the image instead of decoding the file.
+
+constexpr std::uint64_t CacheMagic   = 0x65686361436B6650ULL;  // "PfkCache"
+constexpr std::uint32_t CacheVersion = 1;
+
+struct CacheHeader {
+    std::uint64_t magic;
+    std::uint32_t version;
+    std::uint32_t networkHash;
+    std::uint64_t imageSize;
+    std::uint64_t sourceHash;   // Of the network file
+    std::uint64_t contentHash;  // get_content_hash() of the image
+    char          arch[64];     // The build settings the image layout depends on
+    char          padding[4096 - 104];
+};
+
+static_assert(sizeof(CacheHeader) == 4096, "Cache header must fill a page");
+
+std::string cache_arch() {
+    std::string arch = IsLittleEndian ? "le" : "be";
+#if defined(IS_64BIT)
+    arch += " 64bit";
+#endif
+#if defined(USE_AVX512)
+    arch += " avx512";
+#endif
+#if defined(USE_VNNI)
+    arch += " vnni";
+#endif
+#if defined(USE_AVX2)
+    arch += " avx2";
+#endif
+#if defined(USE_SSE41)
+    arch += " sse41";
+#endif
+#if defined(USE_SSSE3)
+    arch += " ssse3";
+#endif
+#if defined(USE_SSE2)
+    arch += " sse2";
+#endif
+#if defined(USE_NEON)
+    arch += " neon";
+#endif
+#if defined(USE_NEON_DOTPROD)
+    arch += " dotprod";
+#endif
+    return arch;
+}
+
+// The cache of a network file is named after the file, without its directory.
+// Networks with int8 feature transformer weights have their own cache, so that
+// builds of both kinds do not keep replacing the cache of each other.
+std::string
+cache_file(const std::string& directory, const std::string& networkFile, bool scaledWeights) {
+    const std::string name = networkFile.substr(networkFile.find_last_of("/\\") + 1);
+    const bool        slash = directory.back() == '/' || directory.back() == '\\';
+
+    return directory + (slash ? "" : "/") + name + (scaledWeights ? ".int8.cache" : ".cache");
+}
+
+}  // namespace
+
+void register_network_buffer(const std::string& name, const void* data, std::size_t size) {
+    std::lock_guard<std::mutex> lock(networkBuffersMutex);
+
+    if (data)
+        networkBuffers[name] = {data, size};
+    else
+        networkBuffers.erase(name);
+}
+
+void set_network_cache_directory(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(networkCacheDirectoryMutex);
+    networkCacheDirectory = directory;
+}
+
+std::string network_cache_directory() {
+    std::lock_guard<std::mutex> lock(networkCacheDirectoryMutex);
+    return networkCacheDirectory;
+}
+
+
 namespace Detail {
 
 // Read evaluation function parameters
@@ -47,6 +155,17 @@ bool read_parameters(std::istream& stream, T& reference) {
     return reference.read_parameters(stream);
 }
 
+// The feature transformer reads the files of both its weight formats
+template<IndexType Dimensions, typename WeightT>
+bool read_parameters(std::istream& stream, FeatureTransformer<Dimensions, WeightT>& reference) {
+
+    std::uint32_t header;
+    header = read_little_endian<std::uint32_t>(stream);
+    if (!stream || !reference.is_hash_value(header))
+        return false;
+    return reference.read_parameters(stream, header);
+}
+
 // Write evaluation function parameters
 template<typename T>
 bool write_parameters(std::ostream& stream, const T& reference) {
@@ -58,7 +177,9 @@ bool write_parameters(std::ostream& stream, const T& reference) {
 }  // namespace Detail
 
 template<typename Arch, typename Transformer>
-void Network<Arch, Transformer>::load(const std::string& rootDirectory, std::string evalfilePath) {
+void Network<Arch, Transformer>::load(const std::string& rootDirectory,
+                                      std::string        evalfilePath,
+                                      const std::string& cacheDirectory) {
 #if defined(DEFAULT_NNUE_DIRECTORY)
     std::vector<std::string> dirs = {"", rootDirectory, stringify(DEFAULT_NNUE_DIRECTORY)};
 #else
@@ -72,7 +193,7 @@ void Network<Arch, Transformer>::load(const std::string& rootDirectory, std::str
     {
         if (std::string(evalFile.current) != evalfilePath)
         {
-            load_user_net(directory, evalfilePath);
+            load_user_net(directory, evalfilePath, cacheDirectory);
         }
     }
 }
@@ -118,7 +239,7 @@ Network<Arch, Transformer>::evaluate(const Position&                         pos
     constexpr uint64_t alignment = CacheLineSize;
 
     alignas(alignment)
-      TransformedFeatureType transformedFeatures[FeatureTransformer<FTDimensions>::BufferSize];
+      TransformedFeatureType transformedFeatures[Transformer::BufferSize];
 
     ASSERT_ALIGNED(transformedFeatures, alignment);
 
@@ -130,6 +251,25 @@ Network<Arch, Transformer>::evaluate(const Position&                         pos
 }
 
 
+template<typename Arch, typename Transformer>
+int Network<Arch, Transformer>::transform(const Position&                         pos,
+                                          AccumulatorStack&                       accumulatorStack,
+                                          AccumulatorCaches::Cache<FTDimensions>* cache,
+                                          TransformedFeatureType*                 output) const {
+
+    const int bucket = FeatureSet::make_layer_stack_bucket(pos);
+    featureTransformer.transform(pos, accumulatorStack, cache, output, bucket);
+    return bucket;
+}
+
+
+template<typename Arch, typename Transformer>
+std::int32_t Network<Arch, Transformer>::propagate(const TransformedFeatureType* input,
+                                                   int                           bucket) const {
+    return network[bucket].propagate(input);
+}
+
+
 template<typename Arch, typename Transformer>
 void Network<Arch, Transformer>::verify(std::string                                  evalfilePath,
                                         const std::function<void(std::string_view)>& f) const {
@@ -181,7 +321,7 @@ Network<Arch, Transformer>::trace_evaluate(const Position&
     constexpr uint64_t alignment = CacheLineSize;
 
     alignas(alignment)
-      TransformedFeatureType transformedFeatures[FeatureTransformer<FTDimensions>::BufferSize];
+      TransformedFeatureType transformedFeatures[Transformer::BufferSize];
 
     ASSERT_ALIGNED(transformedFeatures, alignment);
 
@@ -203,9 +343,124 @@ Network<Arch, Transformer>::trace_evaluate(const Position&
 
 template<typename Arch, typename Transformer>
 void Network<Arch, Transformer>::load_user_net(const std::string& dir,
+                                               const std::string& evalfilePath,
+                                               const std::string& cacheDirectory) {
+    const void* data = nullptr;
+    void*       mem  = nullptr;
+    std::size_t size = 0;
+
+    // A registered buffer takes the place of a file in the working directory
+    if (dir.empty())
+        if (const auto buffer = find_network_buffer(evalfilePath))
+            std::tie(data, size) = *buffer;
+
+    if (!data && !(data = mem = map_file(dir + evalfilePath, size)))
+        return;
+
+    if (cacheDirectory.empty())
+        load_user_net(data, size, evalfilePath);
+    else
+    {
+        const std::size_t sourceHash = std::hash<std::string_view>{}(
+          std::string_view(static_cast<const char*>(data), size));
+        const std::string cacheFile =
+          cache_file(cacheDirectory, evalfilePath, Transformer::ScaledWeights);
+
+        if (load_cache(cacheFile, sourceHash))
+            evalFile.current = evalfilePath;
+        else
+        {
+            load_user_net(data, size, evalfilePath);
+
+            if (std::string(evalFile.current) == evalfilePath)
+                write_cache(cacheFile, sourceHash);
+        }
+    }
+
+    if (mem)
+        unmap_file(mem, size);
+}
+
+
+// Reads the network image of a cache file written for the same network file
+// and the same build, straight into the network. The image is read rather than
+// mapped and copied, which would keep both resident while loading. Returns
+// false if the cache does not match; a damaged image then leaves the network
+// marked as not loaded.
+template<typename Arch, typename Transformer>
+bool Network<Arch, Transformer>::load_cache(const std::string& cacheFile,
+                                            std::size_t        sourceHash) {
+    std::ifstream in(cacheFile, std::ios::binary | std::ios::ate);
+    CacheHeader   header;
+
+    if (!in || std::size_t(in.tellg()) != sizeof(CacheHeader) + sizeof(Network))
+        return false;
+
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    const std::string arch(header.arch, strnlen(header.arch, sizeof(header.arch)));
+
+    if (!in || header.magic != CacheMagic || header.version != CacheVersion
+        || header.networkHash != Network::hash || header.imageSize != sizeof(Network)
+        || header.sourceHash != sourceHash || arch != cache_arch())
+        return false;
+
+    // The image also carries the EvalFile of the writer, keep ours
+    const EvalFile file = evalFile;
+
+    in.read(reinterpret_cast<char*>(static_cast<void*>(this)), sizeof(Network));
+
+    // Catches a cache file that was damaged after it was written
+    const bool valid = in && get_content_hash() == header.contentHash;
+
+    const FixedString<256> description = evalFile.netDescription;
+    evalFile                           = file;
+    evalFile.netDescription            = description;
+
+    if (!valid)
+        evalFile.current = "None";
+
+    return valid;
+}
+
+
+// Writes the cache file of the network just loaded. The file is written under
+// a temporary name and renamed, so that no other process reads it half written.
+// Failing to write it, for example in a read-only directory, is not an error.
+template<typename Arch, typename Transformer>
+void Network<Arch, Transformer>::write_cache(const std::string& cacheFile,
+                                             std::size_t        sourceHash) const {
+    CacheHeader header{};
+    header.magic       = CacheMagic;
+    header.version     = CacheVersion;
+    header.networkHash = Network::hash;
+    header.imageSize   = sizeof(Network);
+    header.sourceHash  = sourceHash;
+    header.contentHash = get_content_hash();
+    std::strncpy(header.arch, cache_arch().c_str(), sizeof(header.arch) - 1);
+
+    const std::string tmpFile = cacheFile + ".tmp" + std::to_string(now());
+
+    std::ofstream out(tmpFile, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(this), sizeof(Network));
+    out.close();
+
+    if (!out || std::rename(tmpFile.c_str(), cacheFile.c_str()) != 0)
+        std::remove(tmpFile.c_str());
+}
+
+
+// Reads the network from a file image in memory, without copying it first:
+// the parameters are decoded while the file is decompressed.
+template<typename Arch, typename Transformer>
+void Network<Arch, Transformer>::load_user_net(const void*        data,
+                                               std::size_t        size,
                                                const std::string& evalfilePath) {
-    std::stringstream stream(read_compressed_nnue(dir + evalfilePath));
-    auto              description = load(stream);
+    NetworkReadBuf buffer(data, size);
+    std::istream   stream(&buffer);
+    auto           description = load(stream);
 
     if (description.has_value())
     {
@@ -291,7 +546,7 @@ bool Network<Arch, Transformer>::read_parameters(std::istream& stream,
     std::uint32_t hashValue;
     if (!read_header(stream, &hashValue, &netDescription))
         return false;
-    if (hashValue != Network::hash)
+    if (!Transformer::is_hash_value(hashValue ^ Arch::get_hash_value()))
         return false;
     if (!Detail::read_parameters(stream, featureTransformer))
         return false;
@@ -322,6 +577,10 @@ bool Network<Arch, Transformer>::write_parameters(std::ostream&      stream,
 // Explicit template instantiations
 
 template class Network<NetworkArchitecture<TransformedFeatureDimensionsBig, L2Big, L3Big>,
-                       FeatureTransformer<TransformedFeatureDimensionsBig>>;
+                       FeatureTransformer<TransformedFeatureDimensionsBig, std::int16_t>>;
+#if defined(USE_FT_INT8)
+template class Network<NetworkArchitecture<TransformedFeatureDimensionsBig, L2Big, L3Big>,
+                       FeatureTransformer<TransformedFeatureDimensionsBig, std::int8_t>>;
+#endif
 
 }  // namespace Stockfish::Eval::NNUE
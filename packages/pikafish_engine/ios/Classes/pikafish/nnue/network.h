@@ -63,15 +63,31 @@ class Network {
     Network& operator=(const Network& other) = default;
     Network& operator=(Network&& other)      = default;
 
-    void load(const std::string& rootDirectory, std::string evalfilePath);
+    // Loads the network file, through a cache file in 'cacheDirectory' unless
+    // it is empty. See set_network_cache_directory() for the cost of the cache.
+    void load(const std::string& rootDirectory,
+              std::string        evalfilePath,
+              const std::string& cacheDirectory);
     bool save(const std::optional<std::string>& filename) const;
 
     std::size_t get_content_hash() const;
 
+    bool is_loaded(const std::string& evalfilePath) const {
+        return std::string(evalFile.current) == evalfilePath;
+    }
+
     NetworkOutput evaluate(const Position&                         pos,
                            AccumulatorStack&                       accumulatorStack,
                            AccumulatorCaches::Cache<FTDimensions>* cache) const;
 
+    // The two halves of evaluate(), for timing them apart in microbench.
+    // transform() returns the bucket of the layer stack to propagate through.
+    int          transform(const Position&                         pos,
+                           AccumulatorStack&                       accumulatorStack,
+                           AccumulatorCaches::Cache<FTDimensions>* cache,
+                           TransformedFeatureType*                 output) const;
+    std::int32_t propagate(const TransformedFeatureType* input, int bucket) const;
+
 
     void verify(std::string evalfilePath, const std::function<void(std::string_view)>&) const;
     NnueEvalTrace trace_evaluate(const Position&                         pos,
@@ -79,7 +95,11 @@ class Network {
                                  AccumulatorCaches::Cache<FTDimensions>* cache) const;
 
    private:
-    void load_user_net(const std::string&, const std::string&);
+    void load_user_net(const std::string&, const std::string&, const std::string&);
+    void load_user_net(const void*, std::size_t, const std::string&);
+
+    bool load_cache(const std::string&, std::size_t);
+    void write_cache(const std::string&, std::size_t) const;
 
     void initialize();
 
@@ -109,10 +129,23 @@ class Network {
     friend struct AccumulatorCaches::Cache;
 };
 
-// Definitions of the network types
-using BigFeatureTransformer  = FeatureTransformer<TransformedFeatureDimensionsBig>;
+// Definitions of the network types. Builds with USE_FT_INT8 use int8 feature
+// transformer weights, and also build the int16 ones to compare them with.
+using BigFeatureTransformerInt16 =
+  FeatureTransformer<TransformedFeatureDimensionsBig, std::int16_t>;
+
 using BigNetworkArchitecture = NetworkArchitecture<TransformedFeatureDimensionsBig, L2Big, L3Big>;
 
+using NetworkBigInt16 = Network<BigNetworkArchitecture, BigFeatureTransformerInt16>;
+
+#if defined(USE_FT_INT8)
+using BigFeatureTransformerInt8 = FeatureTransformer<TransformedFeatureDimensionsBig, std::int8_t>;
+using BigFeatureTransformer     = BigFeatureTransformerInt8;
+using NetworkBigInt8            = Network<BigNetworkArchitecture, BigFeatureTransformerInt8>;
+#else
+using BigFeatureTransformer = BigFeatureTransformerInt16;
+#endif
+
 using NetworkBig = Network<BigNetworkArchitecture, BigFeatureTransformer>;
 
 
@@ -124,6 +157,22 @@ struct Networks {
 };
 
 
+// Lets an embedding app hand over a network file already in memory, for
+// example a mapped asset. While registered, loading an EvalFile of that name
+// reads the buffer instead of the file system, so the buffer must stay valid
+// until it is unregistered by passing a null 'data'.
+void register_network_buffer(const std::string& name, const void* data, std::size_t size);
+
+// Directory for the cache files of loaded networks, the default of the
+// EvalFileCache option of engines created from then on. Empty, the default,
+// for no cache. A cache file holds the decoded network, about 90 MB for the
+// 9 MB network file with int16 weights and 46 MB with int8 weights, and saves
+// its decoding on later loads. It is written on the first load of a network
+// file, and a directory that cannot take it just means no cache.
+void        set_network_cache_directory(const std::string& directory);
+std::string network_cache_directory();
+
+
 }  // namespace Stockfish
 
 template<typename ArchT, typename FeatureTransformerT>
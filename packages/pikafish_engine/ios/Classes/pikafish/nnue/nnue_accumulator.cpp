@@ -38,27 +38,29 @@ using namespace SIMD;
 
 namespace {
 
-template<Color Perspective, IndexType TransformedFeatureDimensions>
-void double_inc_update(const FeatureTransformer<TransformedFeatureDimensions>& featureTransformer,
-                       const int                                               bucket,
-                       const bool                                              mirror,
-                       AccumulatorState&                                       middle_state,
-                       AccumulatorState&                                       target_state,
-                       const AccumulatorState&                                 computed);
-
-template<Color Perspective, bool Forward, IndexType TransformedFeatureDimensions>
+template<Color Perspective, IndexType TransformedFeatureDimensions, typename WeightT>
+void double_inc_update(
+  const FeatureTransformer<TransformedFeatureDimensions, WeightT>& featureTransformer,
+  const int                                                        bucket,
+  const bool                                                       mirror,
+  AccumulatorState&                                                middle_state,
+  AccumulatorState&                                                target_state,
+  const AccumulatorState&                                          computed);
+
+template<Color Perspective, bool Forward, IndexType TransformedFeatureDimensions, typename WeightT>
 void update_accumulator_incremental(
-  const FeatureTransformer<TransformedFeatureDimensions>& featureTransformer,
-  const int                                               bucket,
-  const bool                                              mirror,
-  AccumulatorState&                                       target_state,
-  const AccumulatorState&                                 computed);
-
-template<Color Perspective, IndexType Dimensions>
-void update_accumulator_refresh_cache(const FeatureTransformer<Dimensions>& featureTransformer,
-                                      const Position&                       pos,
-                                      AccumulatorState&                     accumulatorState,
-                                      AccumulatorCaches::Cache<Dimensions>& cache);
+  const FeatureTransformer<TransformedFeatureDimensions, WeightT>& featureTransformer,
+  const int                                                        bucket,
+  const bool                                                       mirror,
+  AccumulatorState&                                                target_state,
+  const AccumulatorState&                                          computed);
+
+template<Color Perspective, IndexType Dimensions, typename WeightT>
+void update_accumulator_refresh_cache(
+  const FeatureTransformer<Dimensions, WeightT>& featureTransformer,
+  const Position&                                pos,
+  AccumulatorState&                              accumulatorState,
+  AccumulatorCaches::Cache<Dimensions>&          cache);
 
 }
 
@@ -87,19 +89,20 @@ void AccumulatorStack::pop() noexcept {
     size--;
 }
 
-template<IndexType Dimensions>
-void AccumulatorStack::evaluate(const Position&                       pos,
-                                const FeatureTransformer<Dimensions>& featureTransformer,
-                                AccumulatorCaches::Cache<Dimensions>& cache) noexcept {
+template<IndexType Dimensions, typename WeightT>
+void AccumulatorStack::evaluate(const Position&                                pos,
+                                const FeatureTransformer<Dimensions, WeightT>& featureTransformer,
+                                AccumulatorCaches::Cache<Dimensions>&          cache) noexcept {
 
     evaluate_side<WHITE>(pos, featureTransformer, cache);
     evaluate_side<BLACK>(pos, featureTransformer, cache);
 }
 
-template<Color Perspective, IndexType Dimensions>
-void AccumulatorStack::evaluate_side(const Position&                       pos,
-                                     const FeatureTransformer<Dimensions>& featureTransformer,
-                                     AccumulatorCaches::Cache<Dimensions>& cache) noexcept {
+template<Color Perspective, IndexType Dimensions, typename WeightT>
+void AccumulatorStack::evaluate_side(
+  const Position&                                pos,
+  const FeatureTransformer<Dimensions, WeightT>& featureTransformer,
+  AccumulatorCaches::Cache<Dimensions>&          cache) noexcept {
 
     const auto last_usable_accum = find_last_usable_accumulator<Perspective, Dimensions>();
 
@@ -130,11 +133,11 @@ std::size_t AccumulatorStack::find_last_usable_accumulator() const noexcept {
     return 0;
 }
 
-template<Color Perspective, IndexType Dimensions>
+template<Color Perspective, IndexType Dimensions, typename WeightT>
 void AccumulatorStack::forward_update_incremental(
-  const Position&                       pos,
-  const FeatureTransformer<Dimensions>& featureTransformer,
-  const std::size_t                     begin) noexcept {
+  const Position&                                pos,
+  const FeatureTransformer<Dimensions, WeightT>& featureTransformer,
+  const std::size_t                              begin) noexcept {
 
     assert(begin < accumulators.size());
     assert((accumulators[begin].acc<Dimensions>()).computed[Perspective]);
@@ -173,11 +176,11 @@ void AccumulatorStack::forward_update_incremental(
     assert((latest().acc<Dimensions>()).computed[Perspective]);
 }
 
-template<Color Perspective, IndexType Dimensions>
+template<Color Perspective, IndexType Dimensions, typename WeightT>
 void AccumulatorStack::backward_update_incremental(
-  const Position&                       pos,
-  const FeatureTransformer<Dimensions>& featureTransformer,
-  const std::size_t                     end) noexcept {
+  const Position&                                pos,
+  const FeatureTransformer<Dimensions, WeightT>& featureTransformer,
+  const std::size_t                              end) noexcept {
 
     assert(end < accumulators.size());
     assert(end < size);
@@ -198,10 +201,16 @@ void AccumulatorStack::backward_update_incremental(
 }
 
 // Explicit template instantiations
-template void AccumulatorStack::evaluate<TransformedFeatureDimensionsBig>(
-  const Position&                                            pos,
-  const FeatureTransformer<TransformedFeatureDimensionsBig>& featureTransformer,
-  AccumulatorCaches::Cache<TransformedFeatureDimensionsBig>& cache) noexcept;
+template void AccumulatorStack::evaluate<TransformedFeatureDimensionsBig, std::int16_t>(
+  const Position&                                                          pos,
+  const FeatureTransformer<TransformedFeatureDimensionsBig, std::int16_t>& featureTransformer,
+  AccumulatorCaches::Cache<TransformedFeatureDimensionsBig>&               cache) noexcept;
+#if defined(USE_FT_INT8)
+template void AccumulatorStack::evaluate<TransformedFeatureDimensionsBig, std::int8_t>(
+  const Position&                                                         pos,
+  const FeatureTransformer<TransformedFeatureDimensionsBig, std::int8_t>& featureTransformer,
+  AccumulatorCaches::Cache<TransformedFeatureDimensionsBig>&              cache) noexcept;
+#endif
 
 
 namespace {
@@ -223,15 +232,74 @@ void fused_row_reduce(const ElementType* in, ElementType* out, const Ts* const..
           vecIn[i], reinterpret_cast<const typename VectorWrapper::type*>(rows)[i]...);
 }
 
-template<Color Perspective, IndexType Dimensions>
+#if defined(USE_FT_INT8)
+// A row of int8 weights and their scale, which the weights are multiplied by
+// once widened to 16 bits
+struct ScaledRow {
+    const std::int8_t* weights;
+    Vec16Wrapper::type scale;
+};
+#endif
+
+// The row of weights of an input feature, from its element 'offset' on
+template<IndexType Dimensions>
+const Vec16Wrapper::type*
+weight_row(const FeatureTransformer<Dimensions, std::int16_t>& ft,
+           IndexType                                           index,
+           IndexType                                           offset = 0) {
+    return reinterpret_cast<const Vec16Wrapper::type*>(&ft.weights[index * Dimensions + offset]);
+}
+
+#if defined(USE_FT_INT8)
+template<IndexType Dimensions>
+ScaledRow weight_row(const FeatureTransformer<Dimensions, std::int8_t>& ft,
+                     IndexType                                          index,
+                     IndexType                                          offset = 0) {
+#ifdef VECTOR
+    return {&ft.weights[index * Dimensions + offset], vec_set_16(ft.scales[index])};
+#else
+    return {&ft.weights[index * Dimensions + offset], ft.scales[index]};
+#endif
+}
+#endif
+
+// The i-th vector of 16-bit weights of a row
+inline const Vec16Wrapper::type& row_vector(const Vec16Wrapper::type* row, IndexType i) {
+    return row[i];
+}
+
+#if defined(USE_FT_INT8)
+inline Vec16Wrapper::type row_vector(const ScaledRow& row, IndexType i) {
+#ifdef VECTOR
+    return vec_mullo_16(vec_load_i8_16(&row.weights[i * sizeof(vec_t) / 2]), row.scale);
+#else
+    return BiasType(row.weights[i] * row.scale);
+#endif
+}
+#endif
+
+// fused_row_reduce() for rows of weights of either type
+template<IndexType Width, UpdateOperation... ops, typename... Rows>
+void fused_weight_row_reduce(const BiasType* in, BiasType* out, const Rows... rows) {
+    using VecType            = Vec16Wrapper::type;
+    constexpr IndexType size = Width * sizeof(BiasType) / sizeof(VecType);
+
+    auto* vecIn  = reinterpret_cast<const VecType*>(in);
+    auto* vecOut = reinterpret_cast<VecType*>(out);
+
+    for (IndexType i = 0; i < size; ++i)
+        vecOut[i] = fused<Vec16Wrapper, ops...>(vecIn[i], row_vector(rows, i)...);
+}
+
+template<Color Perspective, IndexType Dimensions, typename WeightT>
 struct AccumulatorUpdateContext {
-    const FeatureTransformer<Dimensions>& featureTransformer;
-    const AccumulatorState&               from;
-    AccumulatorState&                     to;
+    const FeatureTransformer<Dimensions, WeightT>& featureTransformer;
+    const AccumulatorState&                        from;
+    AccumulatorState&                              to;
 
-    AccumulatorUpdateContext(const FeatureTransformer<Dimensions>& ft,
-                             const AccumulatorState&               accF,
-                             AccumulatorState&                     accT) noexcept :
+    AccumulatorUpdateContext(const FeatureTransformer<Dimensions, WeightT>& ft,
+                             const AccumulatorState&                        accF,
+                             AccumulatorState&                              accT) noexcept :
         featureTransformer{ft},
         from{accF},
         to{accT} {}
@@ -241,14 +309,14 @@ struct AccumulatorUpdateContext {
              std::enable_if_t<is_all_same_v<IndexType, Ts...>, bool> = true>
     void apply(const Ts... indices) {
         auto to_weight_vector = [&](const IndexType index) {
-            return &featureTransformer.weights[index * Dimensions];
+            return weight_row(featureTransformer, index);
         };
 
         auto to_psqt_weight_vector = [&](const IndexType index) {
             return &featureTransformer.psqtWeights[index * PSQTBuckets];
         };
 
-        fused_row_reduce<Vec16Wrapper, Dimensions, ops...>(
+        fused_weight_row_reduce<Dimensions, ops...>(
           (from.acc<Dimensions>()).accumulation[Perspective],
           (to.acc<Dimensions>()).accumulation[Perspective], to_weight_vector(indices)...);
 
@@ -258,21 +326,23 @@ struct AccumulatorUpdateContext {
     }
 };
 
-template<Color Perspective, IndexType Dimensions>
-auto make_accumulator_update_context(const FeatureTransformer<Dimensions>& featureTransformer,
-                                     const AccumulatorState&               accumulatorFrom,
-                                     AccumulatorState&                     accumulatorTo) noexcept {
-    return AccumulatorUpdateContext<Perspective, Dimensions>{featureTransformer, accumulatorFrom,
-                                                             accumulatorTo};
+template<Color Perspective, IndexType Dimensions, typename WeightT>
+auto make_accumulator_update_context(
+  const FeatureTransformer<Dimensions, WeightT>& featureTransformer,
+  const AccumulatorState&                        accumulatorFrom,
+  AccumulatorState&                              accumulatorTo) noexcept {
+    return AccumulatorUpdateContext<Perspective, Dimensions, WeightT>{
+      featureTransformer, accumulatorFrom, accumulatorTo};
 }
 
-template<Color Perspective, IndexType TransformedFeatureDimensions>
-void double_inc_update(const FeatureTransformer<TransformedFeatureDimensions>& featureTransformer,
-                       const int                                               bucket,
-                       const bool                                              mirror,
-                       AccumulatorState&                                       middle_state,
-                       AccumulatorState&                                       target_state,
-                       const AccumulatorState&                                 computed) {
+template<Color Perspective, IndexType TransformedFeatureDimensions, typename WeightT>
+void double_inc_update(
+  const FeatureTransformer<TransformedFeatureDimensions, WeightT>& featureTransformer,
+  const int                                                        bucket,
+  const bool                                                       mirror,
+  AccumulatorState&                                                middle_state,
+  AccumulatorState&                                                target_state,
+  const AccumulatorState&                                          computed) {
 
     assert(computed.acc<TransformedFeatureDimensions>().computed[Perspective]);
     assert(!middle_state.acc<TransformedFeatureDimensions>().computed[Perspective]);
@@ -311,13 +381,13 @@ void double_inc_update(const FeatureTransformer<TransformedFeatureDimensions>& f
     target_state.acc<TransformedFeatureDimensions>().computed[Perspective] = true;
 }
 
-template<Color Perspective, bool Forward, IndexType TransformedFeatureDimensions>
+template<Color Perspective, bool Forward, IndexType TransformedFeatureDimensions, typename WeightT>
 void update_accumulator_incremental(
-  const FeatureTransformer<TransformedFeatureDimensions>& featureTransformer,
-  const int                                               bucket,
-  const bool                                              mirror,
-  AccumulatorState&                                       target_state,
-  const AccumulatorState&                                 computed) {
+  const FeatureTransformer<TransformedFeatureDimensions, WeightT>& featureTransformer,
+  const int                                                        bucket,
+  const bool                                                       mirror,
+  AccumulatorState&                                                target_state,
+  const AccumulatorState&                                          computed) {
 
     assert((computed.acc<TransformedFeatureDimensions>()).computed[Perspective]);
     assert(!(target_state.acc<TransformedFeatureDimensions>()).computed[Perspective]);
@@ -398,13 +468,18 @@ Bitboard get_changed_pieces(const Piece old[SQUARE_NB], const Piece new_[SQUARE_
 #endif
 }
 
-template<Color Perspective, IndexType Dimensions>
-void update_accumulator_refresh_cache(const FeatureTransformer<Dimensions>& featureTransformer,
-                                      const Position&                       pos,
-                                      AccumulatorState&                     accumulatorState,
-                                      AccumulatorCaches::Cache<Dimensions>& cache) {
+template<Color Perspective, IndexType Dimensions, typename WeightT>
+void update_accumulator_refresh_cache(
+  const FeatureTransformer<Dimensions, WeightT>& featureTransformer,
+  const Position&                                pos,
+  AccumulatorState&                              accumulatorState,
+  AccumulatorCaches::Cache<Dimensions>&          cache) {
 
-    using Tiling [[maybe_unused]] = SIMDTiling<Dimensions, Dimensions, PSQTBuckets>;
+    // Widening int8 weights takes a register for each of the two scales and
+    // for the widened weights on top of the tile
+    using Tiling [[maybe_unused]] =
+      SIMDTiling<Dimensions, Dimensions, PSQTBuckets,
+                 FeatureTransformer<Dimensions, WeightT>::ScaledWeights ? 3 : 0>;
 
     const Square ksq  = pos.king_square(Perspective);
     const Square oksq = pos.king_square(~Perspective);
@@ -462,33 +537,27 @@ void update_accumulator_refresh_cache(const FeatureTransformer<Dimensions>& feat
         IndexType i = 0;
         for (; i < std::min(removed.size(), added.size()); ++i)
         {
-            IndexType       indexR  = removed[i];
-            const IndexType offsetR = Dimensions * indexR + j * Tiling::TileHeight;
-            auto* columnR = reinterpret_cast<const vec_t*>(&featureTransformer.weights[offsetR]);
-            IndexType       indexA  = added[i];
-            const IndexType offsetA = Dimensions * indexA + j * Tiling::TileHeight;
-            auto* columnA = reinterpret_cast<const vec_t*>(&featureTransformer.weights[offsetA]);
+            const auto columnR =
+              weight_row(featureTransformer, removed[i], j * Tiling::TileHeight);
+            const auto columnA = weight_row(featureTransformer, added[i], j * Tiling::TileHeight);
 
             for (IndexType k = 0; k < Tiling::NumRegs; ++k)
-                acc[k] = fused<Vec16Wrapper, Add, Sub>(acc[k], columnA[k], columnR[k]);
+                acc[k] = fused<Vec16Wrapper, Add, Sub>(acc[k], row_vector(columnA, k),
+                                                       row_vector(columnR, k));
         }
         for (; i < removed.size(); ++i)
         {
-            IndexType       index  = removed[i];
-            const IndexType offset = Dimensions * index + j * Tiling::TileHeight;
-            auto* column = reinterpret_cast<const vec_t*>(&featureTransformer.weights[offset]);
+            const auto column = weight_row(featureTransformer, removed[i], j * Tiling::TileHeight);
 
             for (IndexType k = 0; k < Tiling::NumRegs; ++k)
-                acc[k] = vec_sub_16(acc[k], column[k]);
+                acc[k] = vec_sub_16(acc[k], row_vector(column, k));
         }
         for (; i < added.size(); ++i)
         {
-            IndexType       index  = added[i];
-            const IndexType offset = Dimensions * index + j * Tiling::TileHeight;
-            auto* column = reinterpret_cast<const vec_t*>(&featureTransformer.weights[offset]);
+            const auto column = weight_row(featureTransformer, added[i], j * Tiling::TileHeight);
 
             for (IndexType k = 0; k < Tiling::NumRegs; ++k)
-                acc[k] = vec_add_16(acc[k], column[k]);
+                acc[k] = vec_add_16(acc[k], row_vector(column, k));
         }
 
         for (IndexType k = 0; k < Tiling::NumRegs; k++)
@@ -538,18 +607,18 @@ void update_accumulator_refresh_cache(const FeatureTransformer<Dimensions>& feat
 
     for (const auto index : removed)
     {
-        const IndexType offset = Dimensions * index;
+        const auto row = weight_row(featureTransformer, index);
         for (IndexType j = 0; j < Dimensions; ++j)
-            entry.accumulation[j] -= featureTransformer.weights[offset + j];
+            entry.accumulation[j] -= row_vector(row, j);
 
         for (std::size_t k = 0; k < PSQTBuckets; ++k)
             entry.psqtAccumulation[k] -= featureTransformer.psqtWeights[index * PSQTBuckets + k];
     }
     for (const auto index : added)
     {
-        const IndexType offset = Dimensions * index;
+        const auto row = weight_row(featureTransformer, index);
         for (IndexType j = 0; j < Dimensions; ++j)
-            entry.accumulation[j] += featureTransformer.weights[offset + j];
+            entry.accumulation[j] += row_vector(row, j);
 
         for (std::size_t k = 0; k < PSQTBuckets; ++k)
             entry.psqtAccumulation[k] += featureTransformer.psqtWeights[index * PSQTBuckets + k];
@@ -39,7 +39,7 @@ namespace Stockfish::Eval::NNUE {
 template<IndexType Size>
 struct alignas(CacheLineSize) Accumulator;
 
-template<IndexType TransformedFeatureDimensions>
+template<IndexType TransformedFeatureDimensions, typename WeightT>
 class FeatureTransformer;
 
 // Class that holds the result of affine transformation of input features
@@ -151,31 +151,33 @@ class AccumulatorStack {
     void push(const DirtyPiece& dirtyPiece) noexcept;
     void pop() noexcept;
 
-    template<IndexType Dimensions>
-    void evaluate(const Position&                       pos,
-                  const FeatureTransformer<Dimensions>& featureTransformer,
-                  AccumulatorCaches::Cache<Dimensions>& cache) noexcept;
+    template<IndexType Dimensions, typename WeightT>
+    void evaluate(const Position&                                pos,
+                  const FeatureTransformer<Dimensions, WeightT>& featureTransformer,
+                  AccumulatorCaches::Cache<Dimensions>&          cache) noexcept;
 
    private:
     [[nodiscard]] AccumulatorState& mut_latest() noexcept;
 
-    template<Color Perspective, IndexType Dimensions>
-    void evaluate_side(const Position&                       pos,
-                       const FeatureTransformer<Dimensions>& featureTransformer,
-                       AccumulatorCaches::Cache<Dimensions>& cache) noexcept;
+    template<Color Perspective, IndexType Dimensions, typename WeightT>
+    void evaluate_side(const Position&                                pos,
+                       const FeatureTransformer<Dimensions, WeightT>& featureTransformer,
+                       AccumulatorCaches::Cache<Dimensions>&          cache) noexcept;
 
     template<Color Perspective, IndexType Dimensions>
     [[nodiscard]] std::size_t find_last_usable_accumulator() const noexcept;
 
-    template<Color Perspective, IndexType Dimensions>
-    void forward_update_incremental(const Position&                       pos,
-                                    const FeatureTransformer<Dimensions>& featureTransformer,
-                                    const std::size_t                     begin) noexcept;
-
-    template<Color Perspective, IndexType Dimensions>
-    void backward_update_incremental(const Position&                       pos,
-                                     const FeatureTransformer<Dimensions>& featureTransformer,
-                                     const std::size_t                     end) noexcept;
+    template<Color Perspective, IndexType Dimensions, typename WeightT>
+    void
+    forward_update_incremental(const Position&                                pos,
+                               const FeatureTransformer<Dimensions, WeightT>& featureTransformer,
+                               const std::size_t                              begin) noexcept;
+
+    template<Color Perspective, IndexType Dimensions, typename WeightT>
+    void
+    backward_update_incremental(const Position&                                pos,
+                                const FeatureTransformer<Dimensions, WeightT>& featureTransformer,
+                                const std::size_t                              end) noexcept;
 
     std::array<AccumulatorState, MAX_PLY + 1> accumulators;
     std::size_t                               size = 1;
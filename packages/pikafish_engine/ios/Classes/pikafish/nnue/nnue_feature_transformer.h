@@ -23,8 +23,11 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <iosfwd>
+#include <memory>
+#include <type_traits>
 
 #include "../position.h"
 #include "../types.h"
@@ -76,8 +79,37 @@ void permute(T (&data)[N], const std::array<std::size_t, OrderSize>& order) {
     }
 }
 
-// Input feature converter
-template<IndexType TransformedFeatureDimensions>
+// Largest scale of int8 weights. The scales are doubled when they are read, as
+// int16 weights are, and int8 weights times the doubled scale must fit in int16.
+constexpr int MaxWeightScale = 32767 / (2 * 127);
+
+// Quantizes a row of int16 weights to int8 weights times a common scale, the
+// smallest that keeps the weights in range. Weights beyond 127 * MaxWeightScale
+// are clamped. Returns the scale.
+inline std::int16_t
+quantize_row(const std::int16_t* weights, std::int8_t* quantized, std::size_t count) {
+
+    int maxWeight = 0;
+    for (std::size_t i = 0; i < count; ++i)
+        maxWeight = std::max(maxWeight, std::abs(int(weights[i])));
+
+    const int scale = std::clamp((maxWeight + 126) / 127, 1, MaxWeightScale);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const int w  = weights[i];
+        const int q  = (w + (w < 0 ? -scale : scale) / 2) / scale;
+        quantized[i] = std::int8_t(std::clamp(q, -127, 127));
+    }
+
+    return std::int16_t(scale);
+}
+
+// Input feature converter. The weights of the input features are either int16
+// or, to halve the memory and bandwidth they take, int8 with a scale for each
+// input feature, widened and multiplied by their scale when they are added to
+// the accumulator. Both kinds read network files of either format.
+template<IndexType TransformedFeatureDimensions, typename WeightT>
 class FeatureTransformer {
 
     // Number of output dimensions for one side
@@ -87,6 +119,15 @@ class FeatureTransformer {
     // Output type
     using OutputType = TransformedFeatureType;
 
+    // Weight types
+    using WeightType = WeightT;
+    using ScaleType  = std::int16_t;
+
+    static constexpr bool ScaledWeights = std::is_same_v<WeightType, std::int8_t>;
+
+    static_assert(ScaledWeights || std::is_same_v<WeightType, std::int16_t>,
+                  "Feature transformer weights must be int16 or int8");
+
     // Number of input/output dimensions
     static constexpr IndexType InputDimensions  = FeatureSet::Dimensions;
     static constexpr IndexType OutputDimensions = HalfDimensions;
@@ -118,37 +159,82 @@ class FeatureTransformer {
     static constexpr auto InversePackusEpi16Order = invert_permutation(PackusEpi16Order);
 
     // Hash value embedded in the evaluation file
-    static constexpr std::uint32_t get_hash_value() {
-        return FeatureSet::HashValue ^ (OutputDimensions * 2);
+    static constexpr std::uint32_t get_hash_value() { return hash_value(ScaledWeights); }
+
+    // Whether a file with this hash value can be read, in either format
+    static constexpr bool is_hash_value(std::uint32_t hashValue) {
+        return hashValue == hash_value(false) || hashValue == hash_value(true);
     }
 
+    // The weights are permuted as the 16-bit values they widen to, 8 at a time
     void permute_weights() {
         permute<16>(biases, PackusEpi16Order);
-        permute<16>(weights, PackusEpi16Order);
+        permute<8 * sizeof(WeightType)>(weights, PackusEpi16Order);
     }
 
     void unpermute_weights() {
         permute<16>(biases, InversePackusEpi16Order);
-        permute<16>(weights, InversePackusEpi16Order);
+        permute<8 * sizeof(WeightType)>(weights, InversePackusEpi16Order);
     }
 
     inline void scale_weights(bool read) {
-        for (IndexType j = 0; j < InputDimensions; ++j)
-        {
-            WeightType* w = &weights[j * HalfDimensions];
-            for (IndexType i = 0; i < HalfDimensions; ++i)
-                w[i] = read ? w[i] * 2 : w[i] / 2;
-        }
+        if constexpr (ScaledWeights)
+            for (IndexType j = 0; j < InputDimensions; ++j)
+                scales[j] = read ? scales[j] * 2 : scales[j] / 2;
+        else
+            for (IndexType j = 0; j < InputDimensions; ++j)
+            {
+                WeightType* w = &weights[j * HalfDimensions];
+                for (IndexType i = 0; i < HalfDimensions; ++i)
+                    w[i] = read ? w[i] * 2 : w[i] / 2;
+            }
 
         for (IndexType i = 0; i < HalfDimensions; ++i)
             biases[i] = read ? biases[i] * 2 : biases[i] / 2;
     }
 
-    // Read network parameters
-    bool read_parameters(std::istream& stream) {
+    // Read network parameters of the format given by the hash value. Reading
+    // the other format quantizes int16 weights, or widens int8 ones.
+    bool read_parameters(std::istream& stream, std::uint32_t hashValue) {
+
+        constexpr std::size_t WeightCount = std::size_t(HalfDimensions) * InputDimensions;
 
         read_leb_128<BiasType>(stream, biases, HalfDimensions);
-        read_leb_128<WeightType>(stream, weights, HalfDimensions * InputDimensions);
+
+        if (hashValue == get_hash_value())
+        {
+            if constexpr (ScaledWeights)
+            {
+                read_leb_128<ScaleType>(stream, scales, InputDimensions);
+                if (!valid_scales(scales))
+                    return false;
+            }
+            read_leb_128<WeightType>(stream, weights, WeightCount);
+        }
+        else if constexpr (ScaledWeights)
+        {
+            auto wideWeights = std::make_unique<std::int16_t[]>(WeightCount);
+            read_leb_128<std::int16_t>(stream, wideWeights.get(), WeightCount);
+
+            for (IndexType j = 0; j < InputDimensions; ++j)
+                scales[j] = quantize_row(&wideWeights[j * HalfDimensions],
+                                         &weights[j * HalfDimensions], HalfDimensions);
+        }
+        else
+        {
+            auto fileScales  = std::make_unique<ScaleType[]>(InputDimensions);
+            auto fileWeights = std::make_unique<std::int8_t[]>(WeightCount);
+            read_leb_128<ScaleType>(stream, fileScales.get(), InputDimensions);
+            if (!valid_scales(fileScales.get()))
+                return false;
+            read_leb_128<std::int8_t>(stream, fileWeights.get(), WeightCount);
+
+            for (IndexType j = 0; j < InputDimensions; ++j)
+                for (IndexType i = 0; i < HalfDimensions; ++i)
+                    weights[j * HalfDimensions + i] =
+                      fileWeights[j * HalfDimensions + i] * fileScales[j];
+        }
+
         read_leb_128<PSQTWeightType>(stream, psqtWeights, PSQTBuckets * InputDimensions);
 
         permute_weights();
@@ -164,6 +250,8 @@ class FeatureTransformer {
         copy->scale_weights(false);
 
         write_leb_128<BiasType>(stream, copy->biases, HalfDimensions);
+        if constexpr (ScaledWeights)
+            write_leb_128<ScaleType>(stream, copy->scales, InputDimensions);
         write_leb_128<WeightType>(stream, copy->weights, HalfDimensions * InputDimensions);
         write_leb_128<PSQTWeightType>(stream, copy->psqtWeights, PSQTBuckets * InputDimensions);
 
@@ -174,6 +262,8 @@ class FeatureTransformer {
         std::size_t h = 0;
         hash_combine(h, get_raw_data_hash(biases));
         hash_combine(h, get_raw_data_hash(weights));
+        if constexpr (ScaledWeights)
+            hash_combine(h, get_raw_data_hash(scales));
         hash_combine(h, get_raw_data_hash(psqtWeights));
         hash_combine(h, get_hash_value());
         return h;
@@ -312,16 +402,30 @@ class FeatureTransformer {
 
     alignas(CacheLineSize) BiasType biases[HalfDimensions];
     alignas(CacheLineSize) WeightType weights[HalfDimensions * InputDimensions];
+    // Scale of the weights of each input feature, unused by int16 weights
+    alignas(CacheLineSize) ScaleType scales[ScaledWeights ? InputDimensions : 1];
     alignas(CacheLineSize) PSQTWeightType psqtWeights[InputDimensions * PSQTBuckets];
+
+   private:
+    // The int8 format stores a scale for each input feature before the weights
+    static constexpr std::uint32_t hash_value(bool scaledWeights) {
+        return FeatureSet::HashValue ^ (OutputDimensions * 2) ^ (scaledWeights ? 0x1A5C0DE8u : 0);
+    }
+
+    // Scales of a network file, which must keep the read weights in int16 range
+    static bool valid_scales(const ScaleType* fileScales) {
+        return std::all_of(fileScales, fileScales + InputDimensions,
+                           [](ScaleType s) { return s >= 1 && s <= MaxWeightScale; });
+    }
 };
 
 }  // namespace Stockfish::Eval::NNUE
 
 
-template<Stockfish::Eval::NNUE::IndexType TransformedFeatureDimensions>
-struct std::hash<Stockfish::Eval::NNUE::FeatureTransformer<TransformedFeatureDimensions>> {
-    std::size_t
-    operator()(const Stockfish::Eval::NNUE::FeatureTransformer<TransformedFeatureDimensions>& ft)
+template<Stockfish::Eval::NNUE::IndexType TransformedFeatureDimensions, typename WeightT>
+struct std::hash<Stockfish::Eval::NNUE::FeatureTransformer<TransformedFeatureDimensions, WeightT>> {
+    std::size_t operator()(
+      const Stockfish::Eval::NNUE::FeatureTransformer<TransformedFeatureDimensions, WeightT>& ft)
       const noexcept {
         return ft.get_content_hash();
     }
@@ -66,6 +66,10 @@ using vec_uint_t = __m512i;
         #define vec_max_16(a, b) _mm512_max_epi16(a, b)
         #define vec_min_16(a, b) _mm512_min_epi16(a, b)
         #define vec_slli_16(a, b) _mm512_slli_epi16(a, b)
+        #define vec_mullo_16(a, b) _mm512_mullo_epi16(a, b)
+        // Sign extends the int8 at 'a' to a vector of int16
+        #define vec_load_i8_16(a) \
+            _mm512_cvtepi8_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(a)))
         // Inverse permuted at load time
         #define vec_packus_16(a, b) _mm512_packus_epi16(a, b)
     #else
@@ -85,6 +89,12 @@ using vec_uint_t = __m512i;
               _mm256_slli_epi16(__builtin_shufflevector(a, a, 0, 1, 2, 3), b), \
               _mm256_slli_epi16(__builtin_shufflevector(a, a, 4, 5, 6, 7), b), 0, 1, 2, 3, 4, 5, \
               6, 7)
+        #define vec_mullo_16(a, b) vec_op(_mm256_mullo_epi16, a, b)
+        #define vec_load_i8_16(a) \
+            __builtin_shufflevector( \
+              _mm256_cvtepi8_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(a))), \
+              _mm256_cvtepi8_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(a) + 1)), 0, \
+              1, 2, 3, 4, 5, 6, 7)
         // Inverse permuted at load time
         #define vec_packus_16(a, b) vec_op(_mm256_packus_epi16, a, b)
     #endif
@@ -107,6 +117,9 @@ using vec_uint_t = __m256i;
     #define vec_max_16(a, b) _mm256_max_epi16(a, b)
     #define vec_min_16(a, b) _mm256_min_epi16(a, b)
     #define vec_slli_16(a, b) _mm256_slli_epi16(a, b)
+    #define vec_mullo_16(a, b) _mm256_mullo_epi16(a, b)
+    #define vec_load_i8_16(a) \
+        _mm256_cvtepi8_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(a)))
     // Inverse permuted at load time
     #define vec_packus_16(a, b) _mm256_packus_epi16(a, b)
     #define vec_load_psqt(a) _mm256_load_si256(a)
@@ -149,6 +162,18 @@ using vec_uint_t = __m128i;
     #define vec_max_16(a, b) _mm_max_epi16(a, b)
     #define vec_min_16(a, b) _mm_min_epi16(a, b)
     #define vec_slli_16(a, b) _mm_slli_epi16(a, b)
+    #define vec_mullo_16(a, b) _mm_mullo_epi16(a, b)
+    #ifdef USE_SSE41
+        #define vec_load_i8_16(a) \
+            _mm_cvtepi8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(a)))
+    #else
+        // Each int8 goes to the high byte of its int16, and is shifted back down
+        #define vec_load_i8_16(a) \
+            _mm_srai_epi16( \
+              _mm_unpacklo_epi8(_mm_setzero_si128(), \
+                                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(a))), \
+              8)
+    #endif
     #define vec_packus_16(a, b) _mm_packus_epi16(a, b)
     #define vec_load_psqt(a) (*(a))
     #define vec_store_psqt(a, b) *(a) = (b)
@@ -185,6 +210,8 @@ using vec_uint_t = uint32x4_t;
     #define vec_max_16(a, b) vmaxq_s16(a, b)
     #define vec_min_16(a, b) vminq_s16(a, b)
     #define vec_slli_16(a, b) vshlq_s16(a, vec_set_16(b))
+    #define vec_mullo_16(a, b) vmulq_s16(a, b)
+    #define vec_load_i8_16(a) vmovl_s8(vld1_s8(a))
     #define vec_packus_16(a, b) reinterpret_cast<vec_t>(vcombine_u8(vqmovun_s16(a), vqmovun_s16(b)))
     #define vec_load_psqt(a) (*(a))
     #define vec_store_psqt(a, b) *(a) = (b)
@@ -370,8 +397,12 @@ dotprod_m128_add_dpbusd_epi32(int32x4_t& acc, int8x16_t a, int8x16_t b) {
 #endif
 
 
-// Compute optimal SIMD register count for feature transformer accumulation.
-template<IndexType TransformedFeatureWidth, IndexType HalfDimensions, IndexType PSQTBuckets>
+// Compute optimal SIMD register count for feature transformer accumulation,
+// leaving ReservedRegisters free for the accumulation code.
+template<IndexType TransformedFeatureWidth,
+         IndexType HalfDimensions,
+         IndexType PSQTBuckets,
+         int       ReservedRegisters = 0>
 class SIMDTiling {
 #ifdef VECTOR
         // We use __m* types as template arguments, which causes GCC to emit warnings
@@ -411,8 +442,8 @@ class SIMDTiling {
     #endif
 
    public:
-    static constexpr int NumRegs =
-      BestRegisterCount<vec_t, WeightType, TransformedFeatureWidth, NumRegistersSIMD>();
+    static constexpr int NumRegs = BestRegisterCount<vec_t, WeightType, TransformedFeatureWidth,
+                                                     NumRegistersSIMD - ReservedRegisters>();
     static constexpr int NumPsqtRegs =
       BestRegisterCount<psqt_vec_t, PSQTWeightType, PSQTBuckets, NumRegistersSIMD>();
 
@@ -1280,6 +1280,12 @@ class LazyNumaReplicatedSystemWide: public NumaReplicatedBase {
         prepare_replicate_from(std::move(source));
     }
 
+    // Content equal to an allocation still alive, see share(), reuses that allocation
+    LazyNumaReplicatedSystemWide(NumaReplicationContext& ctx, const T& source) :
+        NumaReplicatedBase(ctx) {
+        prepare_replicate_from(source);
+    }
+
     LazyNumaReplicatedSystemWide(const LazyNumaReplicatedSystemWide&) = delete;
     LazyNumaReplicatedSystemWide(LazyNumaReplicatedSystemWide&& other) noexcept :
         NumaReplicatedBase(std::move(other)),
@@ -1325,6 +1331,12 @@ class LazyNumaReplicatedSystemWide: public NumaReplicatedBase {
         return status;
     }
 
+    // Another owner of the first instance, which keeps its allocation alive after
+    // this object is gone. Replicating equal content meanwhile shares it.
+    SystemWideSharedConstant<T> share() const {
+        return SystemWideSharedConstant<T>(*instances[0], get_discriminator(0));
+    }
+
     template<typename FuncT>
     void modify_and_replicate(FuncT&& f) {
         auto source = std::make_unique<T>(*instances[0]);
@@ -1372,7 +1384,9 @@ class LazyNumaReplicatedSystemWide: public NumaReplicatedBase {
         });
     }
 
-    void prepare_replicate_from(std::unique_ptr<T>&& source) {
+    void prepare_replicate_from(std::unique_ptr<T>&& source) { prepare_replicate_from(*source); }
+
+    void prepare_replicate_from(const T& source) {
         instances.clear();
 
         const NumaConfig& cfg = get_numa_config();
@@ -1385,7 +1399,7 @@ class LazyNumaReplicatedSystemWide: public NumaReplicatedBase {
             assert(cfg.num_numa_nodes() > 0);
 
             cfg.execute_on_numa_node(0, [this, &source]() {
-                instances.emplace_back(SystemWideSharedConstant<T>(*source, get_discriminator(0)));
+                instances.emplace_back(SystemWideSharedConstant<T>(source, get_discriminator(0)));
             });
 
             // Prepare others for lazy init.
@@ -1394,7 +1408,7 @@ class LazyNumaReplicatedSystemWide: public NumaReplicatedBase {
         else
         {
             assert(cfg.num_numa_nodes() == 1);
-            instances.emplace_back(SystemWideSharedConstant<T>(*source, get_discriminator(0)));
+            instances.emplace_back(SystemWideSharedConstant<T>(source, get_discriminator(0)));
         }
     }
 };
@@ -19,49 +19,210 @@
 #ifndef PERFT_H_INCLUDED
 #define PERFT_H_INCLUDED
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include "memory.h"
+#include "misc.h"
 #include "movegen.h"
 #include "position.h"
+#include "thread.h"
 #include "types.h"
-#include "uci.h"
 
 namespace Stockfish::Benchmark {
 
-// Utility to verify move generation. All the leaf nodes up
-// to the given depth are generated and counted, and the sum is returned.
-template<bool Root>
-uint64_t perft(Position& pos, Depth depth) {
+// PerftTable caches the leaf counts of perft subtrees by position key and
+// depth. It is shared by the perft threads without locks: an entry keeps its
+// count and the count xor'ed with the key, so a torn entry fails the probe.
+class PerftTable {
+    struct Entry {
+        std::atomic<uint64_t> check, nodes;
+    };
+
+   public:
+    explicit PerftTable(size_t mbSize) :
+        entryCount(std::max<size_t>(1, mbSize * 1024 * 1024 / sizeof(Entry))),
+        table(make_unique_large_page<Entry[]>(entryCount)) {}
+
+    bool probe(Key key, Depth depth, uint64_t& nodes) const {
+        const Key    k = key ^ make_key(depth);
+        const Entry& e = table[mul_hi64(k, entryCount)];
+        uint64_t     n = e.nodes.load(std::memory_order_relaxed);
+
+        if ((e.check.load(std::memory_order_relaxed) ^ n) != k)
+            return false;
+
+        nodes = n;
+        return true;
+    }
+
+    void store(Key key, Depth depth, uint64_t nodes) {
+        const Key k = key ^ make_key(depth);
+        Entry&    e = table[mul_hi64(k, entryCount)];
+
+        e.check.store(k ^ nodes, std::memory_order_relaxed);
+        e.nodes.store(nodes, std::memory_order_relaxed);
+    }
+
+   private:
+    size_t                entryCount;
+    LargePagePtr<Entry[]> table;
+};
+
+// Utility to verify move generation. All the leaf nodes up to the given depth
+// are counted, and the sum is returned. The last ply is bulk counted from the
+// size of the move list. Perft ignores the game rules, so subtrees are keyed
+// by the plain Zobrist key rather than key(), which depends on rule 60.
+inline uint64_t perft(Position& pos, Depth depth, PerftTable& table) {
+
+    if (depth <= 1)
+        return MoveList<LEGAL>(pos).size();
+
+    const Key key = pos.state()->key;
+    uint64_t  nodes;
+
+    if (table.probe(key, depth, nodes))
+        return nodes;
 
     StateInfo st;
+    nodes = 0;
 
-    uint64_t   cnt, nodes = 0;
-    const bool leaf = (depth == 2);
+    for (const auto& m : MoveList<LEGAL>(pos))
+    {
+        pos.do_move(m, st);
+        nodes += perft(pos, depth - 1, table);
+        pos.undo_move(m);
+    }
+
+    table.store(key, depth, nodes);
+    return nodes;
+}
+
+// Walks the tree up to the given depth and compares, at each node, the moves of
+// generate<LEGAL> with those it replaces: the pseudo-legal moves, or evasions
+// in check, which pass Position::legal(). Returns the count of nodes where the
+// two differ, and adds the leaf count, a perft signature, to 'nodes'.
+inline uint64_t movegen_check(Position& pos, Depth depth, uint64_t& nodes) {
+
+    Move expected[MAX_MOVES], *last = expected;
+
+    auto add_legal = [&](const auto& moves) {
+        for (const auto& m : moves)
+            if (pos.legal(m))
+                *last++ = m;
+    };
+
+    if (pos.checkers())
+        add_legal(MoveList<EVASIONS>(pos));
+    else
+        add_legal(MoveList<PSEUDO_LEGAL>(pos));
+
+    const MoveList<LEGAL> legal(pos);
+
+    uint64_t mismatches =
+      legal.size() != size_t(last - expected)
+      || !std::all_of(expected, last, [&](Move m) { return legal.contains(m); });
+
+    if (depth <= 1)
+    {
+        nodes += legal.size();
+        return mismatches;
+    }
+
+    StateInfo st;
+
+    for (const auto& m : legal)
+    {
+        pos.do_move(m, st);
+        mismatches += movegen_check(pos, depth - 1, nodes);
+        pos.undo_move(m);
+    }
+
+    return mismatches;
+}
+
+struct PerftResult {
+    uint64_t                               nodes = 0;
+    std::vector<std::pair<Move, uint64_t>> divide;  // Leaf count of each root move
+};
+
+// Runs perft with the root moves split over the threads of the pool. Each
+// thread sets up its own position and takes root moves from a shared counter,
+// the subtree counts are shared through a table of 'hashMB' megabytes.
+inline PerftResult perft(const std::string& fen, Depth depth, ThreadPool& threads, size_t hashMB) {
+
+    PerftResult result;
+    StateInfo   st;
+    Position    root;
+    root.set(fen, &st);
+
+    for (const auto& m : MoveList<LEGAL>(root))
+        result.divide.emplace_back(m, 1);
+
+    if (depth > 1)
+    {
+        PerftTable          table(hashMB);
+        std::atomic<size_t> next{0};
+
+        for (size_t i = 0; i < threads.num_threads(); ++i)
+            threads.run_on_thread(i, [&]() {
+                StateInfo rootSt, childSt;
+                Position  pos;
+                pos.set(fen, &rootSt);
+
+                for (size_t j; (j = next++) < result.divide.size();)
+                {
+                    auto& [m, cnt] = result.divide[j];
+                    pos.do_move(m, childSt);
+                    cnt = perft(pos, depth - 1, table);
+                    pos.undo_move(m);
+                }
+            });
+
+        for (size_t i = 0; i < threads.num_threads(); ++i)
+            threads.wait_on_thread(i);
+    }
+
+    for (const auto& [m, cnt] : result.divide)
+        result.nodes += cnt;
+
+    return result;
+}
+
+// Perft variant for the game rules: every node is adjudicated by rule_judge()
+// as in search, and nodes ending the game are not expanded. Used to measure
+// repetition and chase detection, 'judged' counts the adjudicated nodes. The
+// Judge=false variant walks the same kind of tree to get the baseline cost.
+template<bool Judge>
+uint64_t rule_perft(Position& pos, Depth depth, int ply, ChaseCache* chaseCache, uint64_t& judged) {
+
+    StateInfo st;
+
+    uint64_t nodes = 0;
 
     for (const auto& m : MoveList<LEGAL>(pos))
     {
-        if (Root && depth <= 1)
-            cnt = 1, nodes++;
+        pos.do_move(m, st);
+
+        Value result = VALUE_NONE;
+        if (Judge && pos.rule_judge(result, ply + 1, chaseCache))
+            nodes++, judged++;
         else
         {
-            pos.do_move(m, st);
-            cnt = leaf ? MoveList<LEGAL>(pos).size() : perft<false>(pos, depth - 1);
-            nodes += cnt;
-            pos.undo_move(m);
+            judged += result != VALUE_NONE;
+            nodes += depth > 1 ? rule_perft<Judge>(pos, depth - 1, ply + 1, chaseCache, judged) : 1;
         }
-        if (Root)
-            sync_cout << UCIEngine::move(m) << ": " << cnt << sync_endl;
+
+        pos.undo_move(m);
     }
     return nodes;
 }
 
-inline uint64_t perft(const std::string& fen, Depth depth) {
-    StateInfo st;
-    Position  p;
-    p.set(fen, &st);
-
-    return perft<true>(p, depth);
-}
 }
 
 #endif  // PERFT_H_INCLUDED
@@ -190,24 +190,37 @@ void Position::set_check_info() const {
     st->needSlowCheck =
       checkers() || (attacks_bb<ROOK>(king_square(sideToMove)) & pieces(~sideToMove, CANNON));
 
-    st->checkSquares[PAWN]   = attacks_bb<PAWN_TO>(ksq, sideToMove);
-    st->checkSquares[KNIGHT] = attacks_bb<KNIGHT_TO>(ksq, pieces());
-    st->checkSquares[CANNON] = attacks_bb<CANNON>(ksq, pieces());
-    st->checkSquares[ROOK]   = attacks_bb<ROOK>(ksq, pieces());
-    st->checkSquares[KING] = st->checkSquares[ADVISOR] = st->checkSquares[BISHOP] = 0;
+    st->rookCheckSquares     = attacks_bb<ROOK>(ksq, pieces());
+    st->hollowCannonDiscover = 0;
+    st->checkSquaresValid    = 0;
 
-    Bitboard hollowCannons = st->checkSquares[ROOK] & pieces(sideToMove, CANNON);
+    Bitboard hollowCannons = st->rookCheckSquares & pieces(sideToMove, CANNON);
     if (hollowCannons)
     {
-        Bitboard hollowCannonDiscover = Bitboard(0);
         while (hollowCannons)
-            hollowCannonDiscover |= between_bb(ksq, pop_lsb(hollowCannons));
-        for (PieceType pt = ROOK; pt < KING; ++pt)
-            st->checkSquares[pt] |= hollowCannonDiscover;
+            st->hollowCannonDiscover |= between_bb(ksq, pop_lsb(hollowCannons));
+        st->rookCheckSquares |= st->hollowCannonDiscover;
     }
 }
 
 
+// Computes the cannon or knight check squares on first use. Most nodes are
+// left before move generation and never need them.
+void Position::set_check_squares(PieceType pt) const {
+
+    assert(pt == CANNON || pt == KNIGHT);
+
+    Square ksq = king_square(~sideToMove);
+
+    if (pt == CANNON)
+        st->cannonCheckSquares = attacks_bb<CANNON>(ksq, pieces()) | st->hollowCannonDiscover;
+    else
+        st->knightCheckSquares = attacks_bb<KNIGHT_TO>(ksq, pieces()) | st->hollowCannonDiscover;
+
+    st->checkSquaresValid |= 1 << pt;
+}
+
+
 // Computes the hash keys of the position, and other
 // data that once computed is updated incrementally as moves are made.
 // The function is only used when a new position is set up
@@ -218,8 +231,9 @@ void Position::set_state() const {
     st->nonPawnKey[WHITE] = st->nonPawnKey[BLACK] = 0;
     st->pawnKey                                   = Zobrist::noPawns;
     st->majorMaterial[WHITE] = st->majorMaterial[BLACK] = VALUE_ZERO;
-    st->checkersBB = checkers_to(~sideToMove, king_square(sideToMove));
-    st->move       = Move::none();
+    st->checkersBB  = checkers_to(~sideToMove, king_square(sideToMove));
+    st->move        = Move::none();
+    st->chasedValid = 0;
 
     set_check_info();
 
@@ -450,8 +464,8 @@ DirtyPiece Position::do_move(Move                      m,
     assert(m.is_ok());
     assert(&newSt != st);
 
-    // Update the bloom filter
-    ++filter[st->key];
+    // Update the repetition table
+    repetitions.add(st->key);
 
     Key k = st->key ^ Zobrist::side;
 
@@ -459,9 +473,10 @@ DirtyPiece Position::do_move(Move                      m,
     // ones which are going to be recalculated from scratch anyway and then switch
     // our state pointer to point to the new (ready to be updated) state.
     std::memcpy(&newSt, st, offsetof(StateInfo, key));
-    newSt.previous = st;
-    st             = &newSt;
-    st->move       = m;
+    newSt.previous  = st;
+    st              = &newSt;
+    st->move        = m;
+    st->chasedValid = 0;
 
     // Increment ply counters. Clamp to 10 checks for each side in rule 60
     // In particular, rule60 will be reset to zero later on in case of a capture.
@@ -622,8 +637,8 @@ void Position::undo_move(Move m) {
     st = st->previous;
     --gamePly;
 
-    // Update the bloom filter
-    --filter[st->key];
+    // Update the repetition table
+    repetitions.remove(st->key);
 
     assert(pos_is_ok());
 }
@@ -636,13 +651,14 @@ void Position::do_null_move(StateInfo& newSt, const TranspositionTable& tt) {
     assert(!checkers());
     assert(&newSt != st);
 
-    // Update the bloom filter
-    ++filter[st->key];
+    // Update the repetition table
+    repetitions.add(st->key);
 
     std::memcpy(&newSt, st, sizeof(StateInfo));
 
-    newSt.previous = st;
-    st             = &newSt;
+    newSt.previous  = st;
+    st              = &newSt;
+    st->chasedValid = 0;
 
     st->key ^= Zobrist::side;
     prefetch(tt.first_entry(key()));
@@ -665,8 +681,8 @@ void Position::undo_null_move() {
     st         = st->previous;
     sideToMove = ~sideToMove;
 
-    // Update the bloom filter
-    --filter[st->key];
+    // Update the repetition table
+    repetitions.remove(st->key);
 }
 
 
@@ -792,18 +808,13 @@ bool Position::see_ge(Move m, int threshold) const {
 
 
 // A lighter version of do_move(), used in chasing detection
-std::pair<Piece, int> Position::do_move(Move m) {
+Piece Position::do_move(Move m) {
 
     assert(capture(m));
 
     Square from     = m.from_sq();
     Square to       = m.to_sq();
     Piece  captured = piece_on(to);
-    int    id       = idBoard[to];
-
-    // Update id board
-    idBoard[to]   = idBoard[from];
-    idBoard[from] = 0;
 
     // Update board and piece lists
     remove_piece(to);
@@ -811,22 +822,18 @@ std::pair<Piece, int> Position::do_move(Move m) {
 
     sideToMove = ~sideToMove;
 
-    return {captured, id};
+    return captured;
 }
 
 
 // A lighter version of undo_move(), used in chasing detection
-void Position::undo_move(Move m, Piece captured, int id) {
+void Position::undo_move(Move m, Piece captured) {
 
     sideToMove = ~sideToMove;
 
     Square from = m.from_sq();
     Square to   = m.to_sq();
 
-    // Put back id board
-    idBoard[from] = idBoard[to];
-    idBoard[to]   = id;
-
     move_piece(to, from);  // Put the piece back at the source square
 
     if (captured)
@@ -857,10 +864,10 @@ bool Position::chase_legal(Move m) const {
 }
 
 
-// Calculates the chase information for a given color.
-uint16_t Position::chased(Color c) {
+// Calculates the squares of the pieces chased by a given color.
+Bitboard Position::chased(Color c) {
 
-    uint16_t chase = 0;
+    Bitboard chase = 0;
 
     std::swap(c, sideToMove);
 
@@ -889,16 +896,16 @@ uint16_t Position::chased(Color c) {
                 // Attacks against stronger pieces
                 if ((attackerType == KNIGHT || attackerType == CANNON)
                     && type_of(piece_on(to)) == ROOK)
-                    chase |= (1 << idBoard[to]);
+                    chase |= to;
                 if ((attackerType == ADVISOR || attackerType == BISHOP)
                     && type_of(piece_on(to)) & 1)
-                    chase |= (1 << idBoard[to]);
+                    chase |= to;
                 // Attacks against potentially unprotected pieces
                 else
                 {
                     bool trueChase             = true;
-                    const auto& [captured, id] = do_move(m);
-                    Bitboard recaptures        = attackers_to(to) & pieces(sideToMove);
+                    Piece    captured   = do_move(m);
+                    Bitboard recaptures = attackers_to(to) & pieces(sideToMove);
                     while (recaptures)
                     {
                         Square s = pop_lsb(recaptures);
@@ -908,7 +915,7 @@ uint16_t Position::chased(Color c) {
                             break;
                         }
                     }
-                    undo_move(m, captured, id);
+                    undo_move(m, captured);
 
                     if (trueChase)
                     {
@@ -918,11 +925,11 @@ uint16_t Position::chased(Color c) {
                             sideToMove = ~sideToMove;
                             if ((attackerType == KNIGHT && ((between_bb(from, to) ^ to) & pieces()))
                                 || !chase_legal(Move(to, from)))
-                                chase |= (1 << idBoard[to]);
+                                chase |= to;
                             sideToMove = ~sideToMove;
                         }
                         else
-                            chase |= (1 << idBoard[to]);
+                            chase |= to;
                     }
                 }
             }
@@ -935,18 +942,91 @@ uint16_t Position::chased(Color c) {
 }
 
 
-// Detects chases from state st - d to state st
+// Returns the ids of the pieces chased by a given color. The squares are kept
+// in the current state, which may only be written when it belongs to the
+// calling thread ('store'): states before the search root are shared.
+uint16_t Position::chased_ids(Color c, bool store, const uint8_t* idBoard) {
+
+    Bitboard b;
+    if (st->chasedValid & (1 << c))
+        b = st->chasedBB[c];
+    else
+    {
+        b = chased(c);
+        if (store)
+        {
+            st->chasedBB[c] = b;
+            st->chasedValid |= 1 << c;
+        }
+    }
+
+    uint16_t ids = 0;
+    while (b)
+        ids |= 1 << idBoard[pop_lsb(b)];
+    return ids;
+}
+
+
+// Fills the chased pieces of the states that a repetition met in search can go
+// back to. Called before a search: these states are shared by the search
+// threads, so they are not written by detect_chases() during it.
+void Position::fill_chased_history() {
+
+    Position rollback;
+    memcpy((void*) &rollback, (const void*) this, offsetof(Position, repetitions));
+
+    for (int i = 0, end = repetition_window();; ++i)
+    {
+        for (Color c : {WHITE, BLACK})
+            if (!(rollback.st->chasedValid & (1 << c)))
+            {
+                rollback.st->chasedBB[c] = rollback.chased(c);
+                rollback.st->chasedValid |= 1 << c;
+            }
+
+        if (i >= end)
+            break;
+
+        rollback.undo_move(rollback.st->move, rollback.st->capturedPiece);
+        rollback.st = rollback.st->previous;
+    }
+}
+
+
+// Number of plies back a repetition of the current position is searched for:
+// rule 60 with the checks added back, within the last null move.
+int Position::repetition_window() const {
+    return std::min(st->rule60 + std::max(0, st->check10[WHITE] - 10)
+                      + std::max(0, st->check10[BLACK] - 10),
+                    int(st->pliesFromNull));
+}
+
+
+// Detects chases from state st - d to state st. The verdict is VALUE_DRAW, or
+// VALUE_MATE/-VALUE_MATE when the side to move wins/loses. 'ply' is the distance
+// to the search root: the chased pieces of states up to it are kept in them,
+// earlier states have theirs filled by fill_chased_history().
 Value Position::detect_chases(int d, int ply) {
 
-    // Grant each piece on board a unique id for each side
-    int whiteId = 0;
-    int blackId = 0;
+    // Grant each piece on board a unique id for each side. The ids are only
+    // needed here, so they are kept out of Position and follow the rollback.
+    uint8_t idBoard[SQUARE_NB] = {};
+    uint8_t whiteId            = 0;
+    uint8_t blackId            = 0;
     for (Square s = SQ_A0; s <= SQ_I9; ++s)
         if (board[s] != NO_PIECE)
             idBoard[s] = color_of(board[s]) == WHITE ? whiteId++ : blackId++;
 
     Color us = sideToMove, them = ~us;
 
+    // Takes back the last move, moving its id along
+    auto undo_chase_move = [&]() {
+        idBoard[st->move.from_sq()] = idBoard[st->move.to_sq()];
+        idBoard[st->move.to_sq()]   = 0;
+        undo_move(st->move, st->capturedPiece);
+        st = st->previous;
+    };
+
     // Rollback until we reached st - d
     uint16_t chase[COLOR_NB] = {0xFFFF, 0xFFFF};
     for (int i = 0; i < d; ++i)
@@ -957,34 +1037,30 @@ Value Position::detect_chases(int d, int ply) {
         {
             if (!chase[sideToMove])
                 break;
-            undo_move(st->move, st->capturedPiece);
-            st = st->previous;
+            undo_chase_move();
         }
         else
         {
-            uint16_t after = chased(~sideToMove);
-            undo_move(st->move, st->capturedPiece);
-            st = st->previous;
+            uint16_t after = chased_ids(~sideToMove, i <= ply, idBoard);
+            undo_chase_move();
             // Take the exact diff to detect the chase
-            chase[sideToMove] &= after & ~chased(sideToMove);
+            chase[sideToMove] &= after & ~chased_ids(sideToMove, i < ply, idBoard);
         }
     }
 
-    return bool(chase[us]) ^ bool(chase[them]) ? chase[us] ? mated_in(ply) : mate_in(ply)
+    return bool(chase[us]) ^ bool(chase[them]) ? chase[us] ? -VALUE_MATE : VALUE_MATE
                                                : VALUE_DRAW;
 }
 
 
 // Tests whether the position may end the game by rule 60, insufficient material, draw repetition,
 // perpetual check repetition or perpetual chase repetition that allows a player to claim a game result.
-bool Position::rule_judge(Value& result, int ply) {
+bool Position::rule_judge(Value& result, int ply, ChaseCache* chaseCache) {
 
     // Restore rule 60 by adding back the checks
-    int end = std::min(st->rule60 + std::max(0, st->check10[WHITE] - 10)
-                         + std::max(0, st->check10[BLACK] - 10),
-                       st->pliesFromNull);
+    int end = repetition_window();
 
-    if (end >= 4 && filter[st->key] >= 1)
+    if (end >= 4 && repetition_count(st->key) >= 1)
     {
         int        cnt       = 0;
         StateInfo* stp       = st->previous->previous;
@@ -1002,12 +1078,26 @@ bool Position::rule_judge(Value& result, int ply) {
             {
                 if (!checkThem && !checkUs)
                 {
-                    // Copy the current position to a rollback struct, so we don't need to do those moves again
-                    Position rollback;
-                    memcpy((void*) &rollback, (const void*) this, offsetof(Position, filter));
+                    // The verdict only depends on the positions of the cycle
+                    Key cycleKey = make_key(i);
+                    for (StateInfo* s = st; s != stp; s = s->previous)
+                        cycleKey = (cycleKey << 1 | cycleKey >> 63) ^ s->key;
+
+                    if (!chaseCache || !chaseCache->probe(cycleKey, result))
+                    {
+                        // Copy the current position to a rollback struct, so we don't need to do those moves again
+                        Position rollback;
+                        memcpy((void*) &rollback, (const void*) this, offsetof(Position, repetitions));
+
+                        // Chasing detection
+                        result = rollback.detect_chases(i, ply);
+                        if (chaseCache)
+                            chaseCache->store(cycleKey, result);
+                    }
 
-                    // Chasing detection
-                    result = rollback.detect_chases(i, ply);
+                    result = result == VALUE_MATE   ? mate_in(ply)
+                           : result == -VALUE_MATE ? mated_in(ply)
+                                                   : result;
                 }
                 else
                     // Checking detection
@@ -1018,7 +1108,7 @@ bool Position::rule_judge(Value& result, int ply) {
                     return true;
 
                 // 2 fold mates need further investigations
-                if (filter[st->key] <= 1)
+                if (repetition_count(st->key) <= 1)
                 {
                     // Not exceeding rule 60 and have the same previous step
                     if (st->rule60 < 120 && st->previous->key == stp->previous->key)
@@ -1026,7 +1116,7 @@ bool Position::rule_judge(Value& result, int ply) {
                         // Even if we entering this loop again, it will not lead to a 3 fold repetition
                         StateInfo* prev = st->previous;
                         while ((prev = prev->previous) != stp)
-                            if (filter[prev->key] > 1)
+                            if (repetition_count(prev->key) > 1)
                                 break;
                         if (prev == stp)
                             return true;
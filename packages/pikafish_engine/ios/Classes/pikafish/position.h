@@ -49,19 +49,33 @@ struct StateInfo {
     Key     nonPawnKey[COLOR_NB];
     Value   majorMaterial[COLOR_NB];
     int16_t check10[COLOR_NB];
-    int     rule60;
-    int     pliesFromNull;
+    int16_t rule60;
+    int16_t pliesFromNull;
 
     // Not copied when making a move (will be recomputed anyhow)
     Key        key;
-    Bitboard   checkersBB;
     StateInfo* previous;
+    Bitboard   checkersBB;
     Bitboard   blockersForKing[COLOR_NB];
     Bitboard   pinners[COLOR_NB];
-    Bitboard   checkSquares[PIECE_TYPE_NB];
-    bool       needSlowCheck;
-    Piece      capturedPiece;
-    Move       move;
+
+    // Squares from which a rook checks the enemy king, and the squares leaving
+    // the line of a hollow cannon. Cannon and knight checks are computed on
+    // first use, bit pt of checkSquaresValid tells whether they are set.
+    Bitboard rookCheckSquares;
+    Bitboard hollowCannonDiscover;
+    Bitboard cannonCheckSquares;
+    Bitboard knightCheckSquares;
+
+    // Squares of the pieces chased by each side, filled lazily during chase
+    // detection. Bit c of chasedValid tells whether chasedBB[c] is set.
+    Bitboard chasedBB[COLOR_NB];
+
+    Move    move;
+    Piece   capturedPiece;
+    bool    needSlowCheck;
+    uint8_t checkSquaresValid;
+    uint8_t chasedValid;
 };
 
 
@@ -71,6 +85,45 @@ struct StateInfo {
 // elements are not invalidated upon list resizing.
 using StateListPtr = std::unique_ptr<std::deque<StateInfo>>;
 
+// ChaseCache is a small per-thread table of perpetual chase verdicts, so that
+// a repetition cycle met again at other nodes is adjudicated only once. The
+// key identifies the cycle by the ordered keys of its positions and its length.
+// Verdicts are stored from the side to move's point of view, relative to the
+// ply where the cycle is closed: VALUE_DRAW, VALUE_MATE or -VALUE_MATE.
+class ChaseCache {
+    static constexpr size_t Size = 4096;
+
+    struct Entry {
+        Key     key;
+        int16_t value;
+    };
+
+   public:
+    bool probe(Key k, Value& v) {
+        const Entry& e = table[k & (Size - 1)];
+        if (e.key != k)
+        {
+            ++misses;
+            return false;
+        }
+        ++hits;
+        v = e.value;
+        return true;
+    }
+
+    void store(Key k, Value v) { table[k & (Size - 1)] = {k, int16_t(v)}; }
+
+    void clear() {
+        std::memset(table, 0, sizeof(table));
+        hits = misses = 0;
+    }
+
+    uint64_t hits = 0, misses = 0;
+
+   private:
+    Entry table[Size] = {};
+};
+
 // Position class stores information regarding the board representation as
 // pieces, side to move, hash keys, etc. Important methods are
 // do_move() and undo_move(), used by the search to update node info when
@@ -149,9 +202,10 @@ class Position {
     // Other properties of the position
     Color    side_to_move() const;
     int      game_ply() const;
-    bool     rule_judge(Value& result, int ply = 0);
+    bool     rule_judge(Value& result, int ply = 0, ChaseCache* chaseCache = nullptr);
+    void     fill_chased_history();
     int      rule60_count() const;
-    uint16_t chased(Color c);
+    Bitboard chased(Color c);
     Value    major_material(Color c) const;
     Value    major_material() const;
 
@@ -168,31 +222,32 @@ class Position {
     // Initialization helpers (used while setting up a position)
     void set_state() const;
     void set_check_info() const;
+    void set_check_squares(PieceType pt) const;
 
     // Other helpers
     void                  move_piece(Square from, Square to);
-    std::pair<Piece, int> do_move(Move m);
-    void                  undo_move(Move m, Piece captured, int id = 0);
-    Value                 detect_chases(int d, int ply = 0);
-    bool                  chase_legal(Move m) const;
-    Key                   adjust_key60(Key k) const;
+    Piece    do_move(Move m);
+    void     undo_move(Move m, Piece captured);
+    int      repetition_window() const;
+    int      repetition_count(Key k) const;
+    Value    detect_chases(int d, int ply = 0);
+    uint16_t chased_ids(Color c, bool store, const uint8_t* idBoard);
+    bool     chase_legal(Move m) const;
+    Key      adjust_key60(Key k) const;
 
     // Data members
-    Piece      board[SQUARE_NB];
     Bitboard   byTypeBB[PIECE_TYPE_NB];
     Bitboard   byColorBB[COLOR_NB];
-    Square     kingSquare[COLOR_NB];
-    int        pieceCount[PIECE_NB];
     uint64_t   midEncoding[COLOR_NB];
     StateInfo* st;
     int        gamePly;
     Color      sideToMove;
+    Square     kingSquare[COLOR_NB];
+    int8_t     pieceCount[PIECE_NB];
+    Piece      board[SQUARE_NB];
 
-    // Bloom filter for fast repetition filtering
-    BloomFilter filter;
-
-    // Board for chasing detection
-    int idBoard[SQUARE_NB];
+    // Keys of the positions on the game path, for fast repetition checks
+    RepetitionTable repetitions;
 };
 
 std::ostream& operator<<(std::ostream& os, const Position& pos);
@@ -263,13 +318,47 @@ inline Bitboard Position::blockers_for_king(Color c) const { return st->blockers
 
 inline Bitboard Position::pinners(Color c) const { return st->pinners[c]; }
 
-inline Bitboard Position::check_squares(PieceType pt) const { return st->checkSquares[pt]; }
+inline Bitboard Position::check_squares(PieceType pt) const {
+    switch (pt)
+    {
+    case ROOK :
+        return st->rookCheckSquares;
+    case PAWN :
+        return attacks_bb<PAWN_TO>(king_square(~sideToMove), sideToMove) | st->hollowCannonDiscover;
+    case CANNON :
+    case KNIGHT :
+        if (!(st->checkSquaresValid & (1 << pt)))
+            set_check_squares(pt);
+        return pt == CANNON ? st->cannonCheckSquares : st->knightCheckSquares;
+    case KING :
+        return 0;
+    default :
+        return st->hollowCannonDiscover;
+    }
+}
 
 inline Key Position::key() const { return adjust_key60(st->key); }
 
 inline Key Position::adjust_key60(Key k) const {
     return (st->rule60 < 14 ? k : k ^ make_key((st->rule60 - 14) / 8))
-         ^ (filter[st->key] ? make_key(14) : 0);
+         ^ (repetition_count(st->key) ? make_key(14) : 0);
+}
+
+// Times a key occurs among the positions before the current one. Found in the
+// repetition table, or by walking the repetition window once the table has
+// overflowed, as it may for a long game played on one Position.
+inline int Position::repetition_count(Key k) const {
+    if (!repetitions.overflowed())
+        return repetitions[k];
+
+    int        count = 0;
+    StateInfo* stp   = st;
+    for (int i = repetition_window(); i > 0 && stp->previous; --i)
+    {
+        stp = stp->previous;
+        count += stp->key == k;
+    }
+    return count;
 }
 
 inline Key Position::pawn_key() const { return st->pawnKey; }
@@ -342,8 +431,14 @@ inline Position& Position::set(const Position& pos, StateInfo* si) {
 
     set(pos.fen(), si);
 
-    // Special cares for bloom filter
-    std::memcpy(&filter, &pos.filter, sizeof(BloomFilter));
+    // Only the positions within the repetition window can be repeated, so
+    // long game histories don't fill the table
+    StateInfo* stp = pos.st;
+    for (int i = pos.repetition_window(); i > 0 && stp->previous; --i)
+    {
+        stp = stp->previous;
+        repetitions.add(stp->key);
+    }
 
     return *this;
 }
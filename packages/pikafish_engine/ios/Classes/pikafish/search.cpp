@@ -154,6 +154,7 @@ void Search::Worker::ensure_network_replicated() {
 void Search::Worker::start_searching() {
 
     accumulatorStack.reset();
+    evalCache.resize(size_t(options["Eval Cache"]));
 
     // Non-main threads go directly to iterative_deepening()
     if (!is_mainthread())
@@ -162,6 +163,15 @@ void Search::Worker::start_searching() {
         return;
     }
 
+    Skill skill(options["Skill Level"], options["UCI_LimitStrength"] ? int(options["UCI_Elo"]) : 0);
+
+    if (skill.enabled())
+    {
+        limits.nodes =
+          limits.nodes ? std::min(limits.nodes, skill.node_budget()) : skill.node_budget();
+        limits.depth = limits.depth ? std::min(limits.depth, skill.pick_depth()) : skill.pick_depth();
+    }
+
     main_manager()->tm.init(limits, rootPos.side_to_move(), rootPos.game_ply(), options,
                             main_manager()->originalTimeAdjust);
     tt.new_search();
@@ -173,8 +183,9 @@ void Search::Worker::start_searching() {
     }
     else
     {
-        threads.start_searching();  // start non-main threads
-        iterative_deepening();      // main thread start searching
+        if (!skill.enabled())
+            threads.start_searching();  // start non-main threads
+        iterative_deepening();          // main thread start searching
     }
 
     // When we reach the maximum depth, we can arrive here without a raise of
@@ -182,8 +193,7 @@ void Search::Worker::start_searching() {
     // the UCI protocol states that we shouldn't print the best move before the
     // GUI sends a "stop" or "ponderhit" command. We therefore simply wait here
     // until the GUI sends one of those commands.
-    while (!threads.stop && (main_manager()->ponder || limits.infinite))
-    {}  // Busy wait for a stop or a ponder reset
+    main_manager()->wait_for_stop_or_ponderhit(threads, limits.infinite);
 
     // Stop the threads if not already stopped (also raise the stop if
     // "ponderhit" just reset threads.ponder)
@@ -210,10 +220,19 @@ void Search::Worker::start_searching() {
     if (bestThread != this)
         main_manager()->pv(*bestThread, threads, tt, bestThread->completedDepth);
 
+    const bool hasPonder = bestThread->rootMoves[0].pv.size() > 1
+                        || bestThread->rootMoves[0].extract_ponder_from_tt(tt, rootPos);
+
+    if (main_manager()->updates.onBestmoveBinary)
+    {
+        main_manager()->updates.onBestmoveBinary(
+          bestThread->rootMoves[0].pv[0], hasPonder ? bestThread->rootMoves[0].pv[1] : Move::none());
+        return;
+    }
+
     std::string ponder;
 
-    if (bestThread->rootMoves[0].pv.size() > 1
-        || bestThread->rootMoves[0].extract_ponder_from_tt(tt, rootPos))
+    if (hasPonder)
         ponder = UCIEngine::move(bestThread->rootMoves[0].pv[1]);
 
     auto bestmove = UCIEngine::move(bestThread->rootMoves[0].pv[0]);
@@ -267,6 +286,12 @@ void Search::Worker::iterative_deepening() {
     }
 
     size_t multiPV = size_t(options["MultiPV"]);
+    Skill skill(options["Skill Level"], options["UCI_LimitStrength"] ? int(options["UCI_Elo"]) : 0);
+
+    // When playing with strength handicap enable MultiPV search that we will
+    // use behind-the-scenes to retrieve a set of possible moves.
+    if (skill.enabled())
+        multiPV = std::max(multiPV, size_t(4));
 
     multiPV = std::min(multiPV, rootMoves.size());
 
@@ -409,6 +434,10 @@ void Search::Worker::iterative_deepening() {
         if (!mainThread)
             continue;
 
+        // If the skill level is enabled and time is up, pick a sub-optimal best move
+        if (skill.enabled() && skill.time_to_pick(rootDepth))
+            skill.pick_best(rootMoves, multiPV);
+
         // Have we found a "mate in x"?
         if (limits.mate && rootMoves[0].score == rootMoves[0].uciScore
             && ((rootMoves[0].score >= VALUE_MATE_IN_MAX_PLY
@@ -473,6 +502,12 @@ void Search::Worker::iterative_deepening() {
         return;
 
     mainThread->previousTimeReduction = timeReduction;
+
+    // If the skill level is enabled, swap the best PV line with the sub-optimal one
+    if (skill.enabled())
+        std::swap(rootMoves[0],
+                  *std::find(rootMoves.begin(), rootMoves.end(),
+                             skill.best ? skill.best : skill.pick_best(rootMoves, multiPV)));
 }
 
 
@@ -529,6 +564,8 @@ void Search::Worker::clear() {
         reductions[i] = int(1696 / 100.0 * std::log(i));
 
     refreshTable.clear(networks[numaAccessToken]);
+    chaseCache.clear();
+    evalCache.clear();
 }
 
 
@@ -588,7 +625,7 @@ Value Search::Worker::search(
     {
         // Step 2. Check for aborted search and repetition
         Value result = VALUE_NONE;
-        if (pos.rule_judge(result, ss->ply))
+        if (pos.rule_judge(result, ss->ply, &chaseCache))
             return result == VALUE_DRAW ? value_draw(nodes) : result;
         if (result != VALUE_NONE)
         {
@@ -1406,7 +1443,7 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta)
 
     // Step 2. Check for repetition or maximum ply reached
     Value result = VALUE_NONE;
-    if (pos.rule_judge(result, ss->ply))
+    if (pos.rule_judge(result, ss->ply, &chaseCache))
         return result;
     if (result != VALUE_NONE)
     {
@@ -1632,7 +1669,7 @@ TimePoint Search::Worker::elapsed_time() const { return main_manager()->tm.elaps
 
 Value Search::Worker::evaluate(const Position& pos) {
     return Eval::evaluate(networks[numaAccessToken], pos, accumulatorStack, refreshTable,
-                          optimism[pos.side_to_move()]);
+                          optimism[pos.side_to_move()], &evalCache);
 }
 
 namespace {
@@ -1760,6 +1797,55 @@ void update_quiet_histories(
 
 }
 
+Search::Skill::Skill(int skill_level, int uci_elo) {
+    if (uci_elo)
+    {
+        double e = double(uci_elo - LowestElo) / (HighestElo - LowestElo);
+        level = std::clamp(std::pow((37.2473 * e - 40.8525) * e + 22.2943, 0.5), 0.0, 19.0);
+    }
+    else
+        level = double(skill_level);
+}
+
+// Nodes allowed for a limited search, from about 1k at level 0 up to about
+// 700k at level 19: a few milliseconds to under a second on one thread.
+uint64_t Search::Skill::node_budget() const { return uint64_t(std::pow(2.0, 10 + level / 2)); }
+
+// When playing with strength handicap, choose the best move among a set of
+// RootMoves using a statistical rule dependent on 'level'. Idea by Heinz van Saanen.
+Move Search::Skill::pick_best(const RootMoves& rootMoves, size_t multiPV) {
+    static PRNG rng(now());  // PRNG sequence should be non-deterministic
+
+    // RootMoves are already sorted by score in descending order. Lines that
+    // were not searched before the node budget ran out are skipped.
+    while (multiPV > 1 && rootMoves[multiPV - 1].score == -VALUE_INFINITE)
+        --multiPV;
+
+    Value  topScore = rootMoves[0].score;
+    int    delta    = std::min(topScore - rootMoves[multiPV - 1].score, int(PawnValue));
+    int    maxScore = -VALUE_INFINITE;
+    double weakness = 120 - 2 * level;
+
+    // Choose best move. For each move score we add two terms, both dependent on
+    // weakness. One is deterministic and bigger for weaker levels, and one is
+    // random. Then we choose the move with the resulting highest score.
+    for (size_t i = 0; i < multiPV; ++i)
+    {
+        // This is our magic formula
+        int push = int(weakness * int(topScore - rootMoves[i].score)
+                       + delta * (rng.rand<unsigned>() % int(weakness)))
+                 / 128;
+
+        if (rootMoves[i].score + push >= maxScore)
+        {
+            maxScore = rootMoves[i].score + push;
+            best     = rootMoves[i].pv[0];
+        }
+    }
+
+    return best;
+}
+
 // Used to print debug info and, more importantly, to detect
 // when we are out of available time and thus stop the search.
 void SearchManager::check_time(Search::Worker& worker) {
@@ -1794,6 +1880,70 @@ void SearchManager::check_time(Search::Worker& worker) {
         worker.threads.stop = worker.threads.abortedSearch = true;
 }
 
+void SearchManager::wait_for_stop_or_ponderhit(const ThreadPool& threads, bool infinite) {
+    std::unique_lock<std::mutex> lk(idleMutex);
+    idleCv.wait(lk, [&] {
+        idleWakeups.fetch_add(1, std::memory_order_relaxed);
+        return threads.stop || !(ponder || infinite);
+    });
+}
+
+// The flag being waited on must be set before calling this. Taking the mutex
+// ensures the waiter either sees the new value or is already blocked.
+void SearchManager::notify_stop_or_ponderhit() {
+    { std::lock_guard<std::mutex> lk(idleMutex); }
+    idleCv.notify_one();
+}
+
+// Same as the text update in pv(), but fills a fixed-layout struct directly
+// from the root move so that no string is formatted.
+void SearchManager::pv_binary(const Search::Worker&     worker,
+                              const ThreadPool&         threads,
+                              const TranspositionTable& tt,
+                              size_t                    idx,
+                              Depth                     depth,
+                              Value                     v,
+                              bool                      updated) const {
+
+    const RootMove& rm = worker.rootMoves[idx];
+    InfoFullBinary  info;
+
+    info.depth    = depth;
+    info.selDepth = rm.selDepth;
+    info.multiPV  = int32_t(idx + 1);
+
+    const Score score(v, worker.rootPos);
+    if (score.is<Score::Mate>())
+    {
+        const int plies = score.get<Score::Mate>().plies;
+        info.scoreType  = InfoFullBinary::SCORE_MATE;
+        info.score      = (plies > 0 ? plies + 1 : plies) / 2;
+    }
+    else
+    {
+        info.scoreType = InfoFullBinary::SCORE_CP;
+        info.score     = score.get<Score::InternalUnits>().value;
+    }
+
+    info.bound = idx == worker.pvIdx && updated
+                 ? (rm.scoreLowerbound   ? InfoFullBinary::BOUND_LOWER
+                    : rm.scoreUpperbound ? InfoFullBinary::BOUND_UPPER
+                                         : InfoFullBinary::BOUND_EXACT)
+                 : InfoFullBinary::BOUND_EXACT;
+
+    TimePoint time = std::max(TimePoint(1), tm.elapsed_time());
+    info.timeMs    = time;
+    info.nodes     = threads.nodes_searched();
+    info.nps       = info.nodes * 1000 / time;
+    info.hashfull  = tt.hashfull();
+
+    info.pvLength = int32_t(std::min(rm.pv.size(), size_t(MAX_PLY)));
+    for (int j = 0; j < info.pvLength; ++j)
+        info.pv[j] = rm.pv[j].raw();
+
+    updates.onUpdateFullBinary(info);
+}
+
 void SearchManager::pv(const Search::Worker&     worker,
                        const ThreadPool&         threads,
                        const TranspositionTable& tt,
@@ -1818,6 +1968,12 @@ void SearchManager::pv(const Search::Worker&     worker,
         if (v == -VALUE_INFINITE)
             v = VALUE_ZERO;
 
+        if (updates.onUpdateFullBinary)
+        {
+            pv_binary(worker, threads, tt, i, d, v, updated);
+            continue;
+        }
+
         std::string pv;
         for (Move m : rootMoves[i].pv)
             pv += UCIEngine::move(m) + " ";
@@ -22,14 +22,17 @@
 #include <array>
 #include <atomic>
 #include <cassert>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
 #include <vector>
 
+#include "evaluate.h"
 #include "history.h"
 #include "misc.h"
 #include "nnue/network.h"
@@ -119,6 +122,7 @@ struct LimitsType {
     bool use_time_management() const { return time[WHITE] || time[BLACK]; }
 
     std::vector<std::string> searchmoves;
+    std::string              divideFile;  // Where perft writes its root move counts
     TimePoint                time[COLOR_NB], inc[COLOR_NB], npmsec, movetime, startTime;
     int                      movestogo, depth, mate, perft, infinite;
     uint64_t                 nodes;
@@ -126,6 +130,30 @@ struct LimitsType {
 };
 
 
+// Skill structure is used to implement strength limit. If we have a UCI_Elo,
+// we convert it to an appropriate skill level. A limited search runs on the
+// main thread only, with a node budget and up to the depth where the move is
+// picked, so weak levels cost a small fraction of a full search.
+struct Skill {
+    // Lowest and highest Elo ratings used in the skill level calculation. The
+    // range and the Elo to level mapping are those of Stockfish, calibrated for
+    // chess and never measured for xiangqi, so UCI_Elo is only a rough guide.
+    constexpr static int LowestElo  = 1280;
+    constexpr static int HighestElo = 3133;
+
+    Skill(int skill_level, int uci_elo);
+
+    bool     enabled() const { return level < 20.0; }
+    Depth    pick_depth() const { return 1 + int(level); }
+    bool     time_to_pick(Depth depth) const { return depth == pick_depth(); }
+    uint64_t node_budget() const;
+    Move     pick_best(const RootMoves&, size_t multiPV);
+
+    double level;
+    Move   best = Move::none();
+};
+
+
 // The UCI stores the uci options, thread pool, and transposition table.
 // This struct is used to easily forward data to the Search::Worker class.
 struct SharedState {
@@ -172,6 +200,35 @@ struct InfoFull: InfoShort {
     int              hashfull;
 };
 
+// Fixed-layout counterpart of InfoFull for binary listeners. It carries no
+// strings: the score is in centipawns or moves to mate as in UCI output and
+// the PV holds Move::raw() values. Mirrored by PikafishSearchInfo in the
+// bridge header, so the layout must not change without updating both.
+struct InfoFullBinary {
+    enum ScoreType : int32_t {
+        SCORE_CP,
+        SCORE_MATE
+    };
+    enum Bound : int32_t {
+        BOUND_EXACT,
+        BOUND_LOWER,
+        BOUND_UPPER
+    };
+
+    int32_t  depth;
+    int32_t  selDepth;
+    int32_t  multiPV;
+    int32_t  scoreType;
+    int32_t  score;
+    int32_t  bound;
+    int32_t  hashfull;
+    int32_t  pvLength;
+    uint64_t timeMs;
+    uint64_t nodes;
+    uint64_t nps;
+    uint16_t pv[MAX_PLY];
+};
+
 struct InfoIteration {
     int              depth;
     std::string_view currmove;
@@ -182,16 +239,22 @@ struct InfoIteration {
 // keeping track of the time, and storing data strictly related to the main thread.
 class SearchManager: public ISearchManager {
    public:
-    using UpdateShort    = std::function<void(const InfoShort&)>;
-    using UpdateFull     = std::function<void(const InfoFull&)>;
-    using UpdateIter     = std::function<void(const InfoIteration&)>;
-    using UpdateBestmove = std::function<void(std::string_view, std::string_view)>;
-
+    using UpdateShort          = std::function<void(const InfoShort&)>;
+    using UpdateFull           = std::function<void(const InfoFull&)>;
+    using UpdateIter           = std::function<void(const InfoIteration&)>;
+    using UpdateBestmove       = std::function<void(std::string_view, std::string_view)>;
+    using UpdateFullBinary     = std::function<void(const InfoFullBinary&)>;
+    using UpdateBestmoveBinary = std::function<void(Move, Move)>;
+
+    // When a binary listener is set it replaces the corresponding text one,
+    // and the PV/bestmove strings are not built at all.
     struct UpdateContext {
-        UpdateShort    onUpdateNoMoves;
-        UpdateFull     onUpdateFull;
-        UpdateIter     onIter;
-        UpdateBestmove onBestmove;
+        UpdateShort          onUpdateNoMoves;
+        UpdateFull           onUpdateFull;
+        UpdateIter           onIter;
+        UpdateBestmove       onBestmove;
+        UpdateFullBinary     onUpdateFullBinary;
+        UpdateBestmoveBinary onBestmoveBinary;
     };
 
 
@@ -205,6 +268,20 @@ class SearchManager: public ISearchManager {
             const TranspositionTable& tt,
             Depth                     depth) const;
 
+    void pv_binary(const Search::Worker&     worker,
+                   const ThreadPool&         threads,
+                   const TranspositionTable& tt,
+                   size_t                    idx,
+                   Depth                     depth,
+                   Value                     v,
+                   bool                      updated) const;
+
+    // Parks the main thread after iterative deepening while pondering or in
+    // an infinite search, until the GUI sends "stop" or "ponderhit".
+    void wait_for_stop_or_ponderhit(const ThreadPool& threads, bool infinite);
+    // Wakes up the main thread parked in wait_for_stop_or_ponderhit()
+    void notify_stop_or_ponderhit();
+
     Stockfish::TimeManagement tm;
     double                    originalTimeAdjust;
     int                       callsCnt;
@@ -218,7 +295,15 @@ class SearchManager: public ISearchManager {
 
     size_t id;
 
+    // Number of times the parked main thread has woken up to recheck its
+    // condition, a busy wait would make this grow without bound.
+    std::atomic<uint64_t> idleWakeups{0};
+
     const UpdateContext& updates;
+
+   private:
+    std::mutex              idleMutex;
+    std::condition_variable idleCv;
 };
 
 class NullSearchManager: public ISearchManager {
@@ -324,6 +409,12 @@ class Worker {
     Eval::NNUE::AccumulatorStack  accumulatorStack;
     Eval::NNUE::AccumulatorCaches refreshTable;
 
+    // Perpetual chase verdicts of repetition cycles met in this thread
+    ChaseCache chaseCache;
+
+    // Network outputs of positions evaluated recently in this thread
+    Eval::EvalCache evalCache;
+
     friend class Stockfish::ThreadPool;
     friend class SearchManager;
 };
@@ -26,12 +26,15 @@
 #include <functional>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <mutex>
 #include <new>
 #include <optional>
 #include <sstream>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <variant>
 
@@ -470,12 +473,31 @@ class SharedMemoryBackend {
 
 #endif
 
+// Local allocation used when shared memory is not available. Allocations are
+// still deduplicated by name within the process, so several engine instances
+// loading the same content share a single copy.
 template<typename T>
 struct SharedMemoryBackendFallback {
     SharedMemoryBackendFallback() = default;
 
-    SharedMemoryBackendFallback(const std::string&, const T& value) :
-        fallback_object(make_unique_large_page<T>(value)) {}
+    SharedMemoryBackendFallback(const std::string& shm_name, const T& value) {
+        static std::mutex                                        mutex;
+        static std::unordered_map<std::string, std::weak_ptr<T>> live;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for (auto it = live.begin(); it != live.end();)
+            it = it->second.expired() ? live.erase(it) : std::next(it);
+
+        auto& slot      = live[shm_name];
+        fallback_object = slot.lock();
+
+        if (!fallback_object)
+        {
+            fallback_object = std::shared_ptr<T>(make_unique_large_page<T>(value));
+            slot            = fallback_object;
+        }
+    }
 
     void* get() const { return fallback_object.get(); }
 
@@ -503,7 +525,7 @@ struct SharedMemoryBackendFallback {
     }
 
    private:
-    LargePagePtr<T> fallback_object;
+    std::shared_ptr<T> fallback_object;
 };
 
 // Platform-independent wrapper
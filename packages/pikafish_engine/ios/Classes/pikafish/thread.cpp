@@ -132,6 +132,30 @@ Search::SearchManager* ThreadPool::main_manager() { return main_thread()->worker
 
 uint64_t ThreadPool::nodes_searched() const { return accumulate(&Search::Worker::nodes); }
 
+// Sums the chase cache hits and misses of all threads
+std::pair<uint64_t, uint64_t> ThreadPool::chase_cache_stats() const {
+
+    uint64_t hits = 0, misses = 0;
+    for (auto&& th : threads)
+    {
+        hits += th->worker->chaseCache.hits;
+        misses += th->worker->chaseCache.misses;
+    }
+    return {hits, misses};
+}
+
+// Sums the eval cache hits and misses of all threads
+std::pair<uint64_t, uint64_t> ThreadPool::eval_cache_stats() const {
+
+    uint64_t hits = 0, misses = 0;
+    for (auto&& th : threads)
+    {
+        hits += th->worker->evalCache.hits;
+        misses += th->worker->evalCache.misses;
+    }
+    return {hits, misses};
+}
+
 // Creates/destroys threads to match the requested number.
 // Created and launched threads will immediately go to sleep in idle_loop.
 // Upon resizing, threads are recreated to allow for binding if necessary.
@@ -266,6 +290,9 @@ void ThreadPool::start_thinking(Position& pos, StateListPtr& states, Search::Lim
     if (states.get())
         setupStates = std::move(states);  // Ownership transfer, states is now empty
 
+    // Chase detection only reads the chased pieces of the shared states
+    pos.fill_chased_history();
+
     // We use Position::set() to set root position across threads. But there are
     // some StateInfo fields (previous, pliesFromNull, capturedPiece) that cannot
     // be deduced from a fen string, so set() clears them and they are set from
@@ -26,6 +26,7 @@
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <utility>
 #include <vector>
 
 #include "memory.h"
@@ -144,10 +145,16 @@ class ThreadPool {
     void                   start_searching();
     void                   wait_for_search_finished() const;
 
+    std::pair<uint64_t, uint64_t> chase_cache_stats() const;
+    std::pair<uint64_t, uint64_t> eval_cache_stats() const;
+
     std::vector<size_t> get_bound_thread_count_by_numa_node() const;
 
     void ensure_network_replicated();
 
+    // hands the state list of the last search back to the caller
+    StateListPtr release_setup_states() { return std::move(setupStates); }
+
     std::atomic_bool stop, abortedSearch, increaseDepth;
 
     auto cbegin() const noexcept { return threads.cbegin(); }
@@ -18,12 +18,16 @@
 
 #include "tt.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <fstream>
 #include <functional>
 #include <iostream>
+#include <utility>
+#include <vector>
 
 #include "memory.h"
 #include "misc.h"
@@ -149,16 +153,77 @@ struct Cluster {
 static_assert(sizeof(Cluster) == 32, "Suboptimal Cluster size");
 
 
+// A saved table is this header followed by the cluster array. The header takes
+// a whole page, so that the clusters of a mapped file are suitably aligned.
+
+static constexpr uint64_t TTFileMagic   = 0x5454687369666B50ULL;  // "PkfishTT"
+static constexpr uint32_t TTFileVersion = 1;
+
+struct TTFileHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t clusterBytes;
+    uint64_t clusterCount;
+    uint64_t fingerprint;
+    uint8_t  generation8;
+    uint8_t  padding[7];
+    uint64_t checksum;  // Of the fields above
+    char     reserved[4096 - 48];
+
+    uint64_t compute_checksum() const {
+        uint64_t h = 0xcbf29ce484222325ULL;  // FNV-1a
+        for (const uint8_t* p = reinterpret_cast<const uint8_t*>(this);
+             p < reinterpret_cast<const uint8_t*>(&checksum); ++p)
+            h = (h ^ *p) * 0x100000001b3ULL;
+        return h;
+    }
+};
+
+static_assert(sizeof(TTFileHeader) == 4096, "TT file header must fill a page");
+
+
+void TranspositionTable::free_table() {
+    if (mappedMemory)
+        unmap_file(mappedMemory, mappedSize);
+    else
+        aligned_large_pages_free(table);
+
+    table        = nullptr;
+    mappedMemory = nullptr;
+    mappedSize   = 0;
+}
+
+
 // Sets the size of the transposition table,
 // measured in megabytes. Transposition table consists
 // of clusters and each cluster consists of ClusterSize number of TTEntry.
-void TranspositionTable::resize(size_t mbSize, ThreadPool& threads) {
-    aligned_large_pages_free(table);
+// The entries of the previous table are rehashed into the new one, and the
+// number of them that found a place is returned. Both tables are held while
+// the entries move, so if there is no memory for that the previous table is
+// freed first and its entries are lost.
+size_t TranspositionTable::resize(size_t mbSize, ThreadPool& threads) {
+    const Cluster* oldTable   = std::exchange(table, nullptr);
+    const size_t   oldCount   = clusterCount;
+    void*          oldMapping = std::exchange(mappedMemory, nullptr);
+    const size_t   oldMapSize = std::exchange(mappedSize, 0);
+    const uint8_t  generation = generation8;
 
     clusterCount = mbSize * 1024 * 1024 / sizeof(Cluster);
 
     table = static_cast<Cluster*>(aligned_large_pages_alloc(clusterCount * sizeof(Cluster)));
 
+    if (!table && oldTable)
+    {
+        if (oldMapping)
+            unmap_file(oldMapping, oldMapSize);
+        else
+            aligned_large_pages_free(const_cast<Cluster*>(oldTable));
+
+        oldTable = nullptr;
+
+        table = static_cast<Cluster*>(aligned_large_pages_alloc(clusterCount * sizeof(Cluster)));
+    }
+
     if (!table)
     {
         std::cerr << "Failed to allocate " << mbSize << "MB for transposition table." << std::endl;
@@ -166,6 +231,112 @@ void TranspositionTable::resize(size_t mbSize, ThreadPool& threads) {
     }
 
     clear(threads);
+
+    if (!oldTable)
+        return 0;
+
+    // Keep the ages of the migrated entries
+    generation8       = generation;
+    const size_t kept = migrate(oldTable, oldCount, threads);
+
+    if (oldMapping)
+        unmap_file(oldMapping, oldMapSize);
+    else
+        aligned_large_pages_free(const_cast<Cluster*>(oldTable));
+
+    return kept;
+}
+
+
+// Returns the first and last cluster of a table of 'count' clusters that can
+// hold the keys of cluster 'i' of a table of 'oldCount' clusters. Only the low
+// 16 bits of a key are stored, so when the table grows the entry could belong
+// to any cluster of the range.
+static std::pair<size_t, size_t>
+target_clusters(uint64_t i, uint64_t oldCount, uint64_t count) {
+#if defined(__GNUC__) && defined(IS_64BIT)
+    __extension__ using uint128 = unsigned __int128;
+    return {size_t(uint128(i) * count / oldCount),
+            size_t((uint128(i + 1) * count - 1) / oldCount)};
+#else
+    // Rounding may be off by one cluster, so widen the range by one each side
+    const double r = double(count) / oldCount;
+    return {size_t(std::max(i * r - 1, 0.0)),
+            size_t(std::min((i + 1) * r + 1, double(count - 1)))};
+#endif
+}
+
+
+// Moves the occupied entries of the old table into the table just cleared,
+// each old cluster to all its target clusters, with the replacement policy of
+// probe(). Every thread handles a contiguous part of the old table, so they
+// only share target clusters at the edges of the parts, where races are
+// tolerated as in the search.
+size_t TranspositionTable::migrate(const Cluster* oldTable,
+                                   size_t         oldCount,
+                                   ThreadPool&    threads) {
+    const size_t        threadCount = threads.num_threads();
+    std::vector<size_t> kept(threadCount);
+
+    for (size_t t = 0; t < threadCount; ++t)
+    {
+        threads.run_on_thread(t, [this, t, threadCount, oldTable, oldCount, &kept]() {
+            const size_t stride = oldCount / threadCount;
+            const size_t start  = stride * t;
+            const size_t end    = t + 1 != threadCount ? start + stride : oldCount;
+
+            for (size_t i = start; i < end; ++i)
+            {
+                const auto [first, last] = target_clusters(i, oldCount, clusterCount);
+
+                for (const TTEntry& e : oldTable[i].entry)
+                {
+                    if (!e.is_occupied())
+                        continue;
+
+                    const int value  = e.depth8 - e.relative_age(generation8);
+                    bool      stored = false;
+
+                    for (size_t c = first; c <= last; ++c)
+                    {
+                        TTEntry* const tte     = table[c].entry;
+                        TTEntry*       replace = nullptr;
+
+                        for (int j = 0; j < ClusterSize && !replace; ++j)
+                            if (tte[j].key16 == e.key16)
+                                replace = &tte[j];
+
+                        if (!replace)
+                        {
+                            replace = tte;
+                            for (int j = 1; j < ClusterSize; ++j)
+                                if (replace->depth8 - replace->relative_age(generation8)
+                                    > tte[j].depth8 - tte[j].relative_age(generation8))
+                                    replace = &tte[j];
+                        }
+
+                        if (!replace->is_occupied()
+                            || value > replace->depth8 - replace->relative_age(generation8))
+                        {
+                            *replace = e;
+                            stored   = true;
+                        }
+                    }
+
+                    kept[t] += stored;
+                }
+            }
+        });
+    }
+
+    size_t total = 0;
+    for (size_t t = 0; t < threadCount; ++t)
+    {
+        threads.wait_on_thread(t);
+        total += kept[t];
+    }
+
+    return total;
 }
 
 
@@ -192,6 +363,82 @@ void TranspositionTable::clear(ThreadPool& threads) {
 }
 
 
+// Writes the header and then the cluster array to 'file'. The search must not
+// be running, otherwise the saved entries may be torn.
+std::optional<std::string> TranspositionTable::save(const std::string& file,
+                                                    Key                fingerprint) const {
+
+    TTFileHeader header{};
+    header.magic        = TTFileMagic;
+    header.version      = TTFileVersion;
+    header.clusterBytes = sizeof(Cluster);
+    header.clusterCount = clusterCount;
+    header.fingerprint  = fingerprint;
+    header.generation8  = generation8;
+    header.checksum     = header.compute_checksum();
+
+    std::ofstream out(file, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(table), std::streamsize(clusterCount * sizeof(Cluster)));
+    out.close();
+
+    if (!out)
+        return "Failed to write the transposition table to " + file;
+
+    return std::nullopt;
+}
+
+
+// Replaces the table with a private mapping of a file written by save(). Only
+// the header is read here: the clusters are paged in by the search as it probes
+// them, so loading is instant whatever the size. On failure the table is kept.
+std::optional<std::string> TranspositionTable::load(const std::string& file, Key fingerprint) {
+
+    size_t size = 0;
+    void*  mem  = map_file(file, size);
+
+    if (!mem)
+        return "Failed to map " + file;
+
+    const TTFileHeader& header = *static_cast<const TTFileHeader*>(mem);
+    std::optional<std::string> error;
+
+    if (size < sizeof(TTFileHeader) || header.magic != TTFileMagic)
+        error = file + " is not a transposition table file";
+    else if (header.checksum != header.compute_checksum())
+        error = file + " has a corrupted header";
+    else if (header.version != TTFileVersion || header.clusterBytes != sizeof(Cluster)
+             || header.fingerprint != fingerprint)
+        error = file + " was written by an incompatible engine version";
+    else if (header.clusterCount < 1000
+             || size != sizeof(TTFileHeader) + header.clusterCount * sizeof(Cluster))
+        error = file + " is truncated";
+
+    if (error)
+    {
+        unmap_file(mem, size);
+        return error;
+    }
+
+    free_table();
+
+    mappedMemory = mem;
+    mappedSize   = size;
+    clusterCount = header.clusterCount;
+    generation8  = header.generation8;
+    table        = reinterpret_cast<Cluster*>(static_cast<char*>(mem) + sizeof(TTFileHeader));
+
+    return std::nullopt;
+}
+
+
+// Returns the size of the table in megabytes, which differs from the Hash
+// option after loading a table saved with another size.
+size_t TranspositionTable::size_mb() const {
+    return clusterCount * sizeof(Cluster) / (1024 * 1024);
+}
+
+
 // Returns an approximation of the hashtable
 // occupation during a search. The hash is x permill full, as per UCI protocol.
 // Only counts entries which match the current generation.
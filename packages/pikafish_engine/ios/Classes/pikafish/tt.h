@@ -21,6 +21,8 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <optional>
+#include <string>
 #include <tuple>
 
 #include "memory.h"
@@ -78,10 +80,16 @@ struct TTWriter {
 class TranspositionTable {
 
    public:
-    ~TranspositionTable() { aligned_large_pages_free(table); }
+    ~TranspositionTable() { free_table(); }
 
-    void resize(size_t mbSize, ThreadPool& threads);  // Set TT size
-    void clear(ThreadPool& threads);                  // Re-initialize memory, multithreaded
+    size_t resize(size_t mbSize, ThreadPool& threads);  // Set TT size, returns entries kept
+    void   clear(ThreadPool& threads);                  // Re-initialize memory, multithreaded
+
+    // Write the table to a file, or replace it with a copy-on-write mapping of
+    // one. 'fingerprint' identifies the hash keys; returns an error, if any.
+    std::optional<std::string> save(const std::string& file, Key fingerprint) const;
+    std::optional<std::string> load(const std::string& file, Key fingerprint);
+    size_t                     size_mb() const;
     int  hashfull(int maxAge = 0)
       const;  // Approximate what fraction of entries (permille) have been written to during this root search
 
@@ -96,9 +104,16 @@ class TranspositionTable {
    private:
     friend struct TTEntry;
 
+    void   free_table();
+    size_t migrate(const Cluster* oldTable, size_t oldCount, ThreadPool& threads);
+
     size_t   clusterCount;
     Cluster* table = nullptr;
 
+    // Set while the table lives in a file mapping made by load()
+    void*  mappedMemory = nullptr;
+    size_t mappedSize   = 0;
+
     uint8_t generation8 = 0;  // Size must be not bigger than TTEntry::genBound8
 };
 
@@ -270,14 +270,81 @@ enum Rank : int8_t {
     RANK_NB
 };
 
-// For fast repetition checks
-struct BloomFilter {
-    constexpr static uint64_t FILTER_SIZE = 1 << 14;
-    uint8_t                   operator[](Key key) const { return table[key & (FILTER_SIZE - 1)]; }
-    uint8_t&                  operator[](Key key) { return table[key & (FILTER_SIZE - 1)]; }
+// For fast repetition checks: an exact multiset of the keys of the positions
+// on the current game path, with linear probing. Entries are removed with a
+// backward shift, so no tombstones are left behind. Keys are added and removed
+// in stack order; once the table is too loaded further keys are only counted,
+// and until they are removed again lookups are not exact: every key reports a
+// possible repetition, see overflowed().
+class RepetitionTable {
+    static constexpr size_t Size    = 512;
+    static constexpr size_t Mask    = Size - 1;
+    static constexpr size_t MaxLoad = Size * 3 / 4;
+
+   public:
+    uint8_t operator[](Key key) const {
+        if (overflow)
+            return UINT8_MAX;
+
+        for (size_t i = key & Mask; counts[i]; i = (i + 1) & Mask)
+            if (keys[i] == key)
+                return counts[i];
+        return 0;
+    }
+
+    bool overflowed() const { return overflow; }
+
+    void add(Key key) {
+        if (overflow || used >= MaxLoad)
+        {
+            ++overflow;
+            return;
+        }
+
+        size_t i = key & Mask;
+        while (counts[i] && keys[i] != key)
+            i = (i + 1) & Mask;
+
+        if (!counts[i])
+        {
+            keys[i] = key;
+            ++used;
+        }
+        ++counts[i];
+    }
+
+    void remove(Key key) {
+        if (overflow)
+        {
+            --overflow;
+            return;
+        }
+
+        size_t i = key & Mask;
+        while (keys[i] != key || !counts[i])
+            i = (i + 1) & Mask;
+
+        if (--counts[i])
+            return;
+
+        --used;
+
+        // Move back the entries of the cluster that may not be reached anymore
+        for (size_t j = (i + 1) & Mask; counts[j]; j = (j + 1) & Mask)
+            if (((j - keys[j]) & Mask) >= ((j - i) & Mask))
+            {
+                keys[i]   = keys[j];
+                counts[i] = counts[j];
+                counts[j] = 0;
+                i         = j;
+            }
+    }
 
    private:
-    uint8_t table[1 << 14];
+    Key      keys[Size];
+    uint8_t  counts[Size];
+    uint16_t used;
+    uint16_t overflow;
 };
 
 // Keep track of what a move changes on the board (used by NNUE)
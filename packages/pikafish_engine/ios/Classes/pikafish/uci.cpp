@@ -8,26 +8,24 @@
 #include "uci.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <fstream>
 #include <functional>
+#include <iomanip>
 #include <iterator>
+#include <map>
 #include <optional>
 #include <sstream>
 #include <string_view>
 #include <utility>
 #include <vector>
 
-// --- THÊM: THƯ VIỆN CHO IOS BRIDGE ---
-#include <atomic>
-#include <mutex>
-#include <condition_variable>
-#include <deque>
-// -------------------------------------
-
 #include "benchmark.h"
 #include "engine.h"
 #include "memory.h"
 #include "movegen.h"
+#include "perft.h"
 #include "position.h"
 #include "score.h"
 #include "search.h"
@@ -38,30 +36,29 @@
 // PHẦN CẦU NỐI IOS (IOS BRIDGE SECTION)
 // ----------------------------------------------------------------------------
 
-// Hàm gửi dữ liệu về Dart (được cài đặt trong ios_bridge.mm)
-extern "C" void write_to_dart_buffer(const char* cstr);
-
-// Cấu trúc hàng đợi lệnh an toàn luồng
-static std::deque<std::string> ios_command_queue;
-static std::mutex ios_command_mutex;
-static std::condition_variable ios_command_cv;
-static std::atomic<bool> ios_engine_running{false};
-
-// Hàm nội bộ: Gửi string về Dart (thay thế cho sync_cout)
-static void ios_post_output(const std::string& msg) {
-    if (msg.empty()) return;
-    // Gọi sang Objective-C++
-    write_to_dart_buffer(msg.c_str());
+// Kênh mặc định của process: output đi qua write_to_dart_buffer (ios_bridge.mm)
+static Stockfish::UCIChannel& ios_channel() {
+    static Stockfish::UCIChannel channel([](const char* text) { write_to_dart_buffer(text); });
+    return channel;
 }
 
 // Hàm nhận lệnh từ Dart (được gọi từ ios_bridge.mm)
 extern "C" void uci_inject_command(const char* cmd) {
     if (cmd == nullptr) return;
-    {
-        std::lock_guard<std::mutex> lock(ios_command_mutex);
-        ios_command_queue.emplace_back(std::string(cmd));
-    }
-    ios_command_cv.notify_one();
+    ios_channel().push_command(cmd);
+}
+
+extern "C" void uci_set_search_listener(uci_info_listener onInfo, uci_bestmove_listener onBestmove) {
+    ios_channel().set_search_listener(onInfo, onBestmove);
+}
+
+extern "C" void
+uci_get_reanalyze_stats(uint64_t* count, uint64_t* lastUs, uint64_t* maxUs, uint64_t* totalUs) {
+    const auto stats = ios_channel().first_info_stats();
+    if (count) *count = stats.count;
+    if (lastUs) *lastUs = stats.lastUs;
+    if (maxUs) *maxUs = stats.maxUs;
+    if (totalUs) *totalUs = stats.totalUs;
 }
 // ----------------------------------------------------------------------------
 
@@ -80,6 +77,77 @@ struct overload: Ts... {
 template<typename... Ts>
 overload(Ts...) -> overload<Ts...>;
 
+namespace {
+
+std::int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}
+
+void UCIChannel::push_command(std::string cmd) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        commands.emplace_back(std::move(cmd));
+    }
+    cv.notify_one();
+}
+
+bool UCIChannel::wait_command(std::string& cmd) {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return !commands.empty() || !running; });
+
+    if (!running)
+        return false;
+
+    cmd = std::move(commands.front());
+    commands.pop_front();
+    return true;
+}
+
+void UCIChannel::open() {
+    std::lock_guard<std::mutex> lock(mutex);
+    running = true;
+}
+
+void UCIChannel::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    cv.notify_all();
+}
+
+// Thay thế cho sync_cout
+void UCIChannel::post(const std::string& msg) const {
+    if (msg.empty())
+        return;
+    sink(msg.c_str());
+}
+
+void UCIChannel::set_search_listener(InfoListener onInfo, BestmoveListener onBestmove) {
+    infoListener.store(onInfo);
+    bestmoveListener.store(onBestmove);
+}
+
+void UCIChannel::record_first_info(std::uint64_t us) {
+    firstInfoCount.fetch_add(1, std::memory_order_relaxed);
+    firstInfoLastUs.store(us, std::memory_order_relaxed);
+    firstInfoTotalUs.fetch_add(us, std::memory_order_relaxed);
+
+    auto prevMax = firstInfoMaxUs.load(std::memory_order_relaxed);
+    while (prevMax < us && !firstInfoMaxUs.compare_exchange_weak(prevMax, us)) {}
+}
+
+UCIChannel::LatencyStats UCIChannel::first_info_stats() const {
+    return {firstInfoCount.load(std::memory_order_relaxed),
+            firstInfoLastUs.load(std::memory_order_relaxed),
+            firstInfoMaxUs.load(std::memory_order_relaxed),
+            firstInfoTotalUs.load(std::memory_order_relaxed)};
+}
+
 // MODIFIED: Chuyển hướng output sang iOS Bridge
 void UCIEngine::print_info_string(std::string_view str) {
     for (auto& line : split(str, "\n"))
@@ -89,14 +157,18 @@ void UCIEngine::print_info_string(std::string_view str) {
             // Fix lỗi Xcode: Ép kiểu string_view sang string tường minh
             std::string lineStr = std::string(line); 
             std::string out = "info string " + lineStr;
-            ios_post_output(out);
+            channel.post(out);
         }
     }
 }
 
 UCIEngine::UCIEngine(int argc, char** argv) :
+    UCIEngine(argc, argv, ios_channel()) {}
+
+UCIEngine::UCIEngine(int argc, char** argv, UCIChannel& ch) :
     engine(argv[0]),
-    cli(argc, argv) {
+    cli(argc, argv),
+    channel(ch) {
 
     engine.get_options().add_info_listener([this](const std::optional<std::string>& str) {
         if (str.has_value())
@@ -123,22 +195,13 @@ void UCIEngine::loop() {
         cmd += std::string(cli.argv[i]) + " ";
 
     // Đánh dấu engine bắt đầu chạy
-    ios_engine_running.store(true);
+    channel.open();
 
     do
     {
         // Nếu không có tham số dòng lệnh (chạy mode thư viện), chờ lệnh từ App
-        if (cli.argc == 1) {
-            std::unique_lock<std::mutex> lock(ios_command_mutex);
-            ios_command_cv.wait(lock, [] {
-                return !ios_command_queue.empty() || !ios_engine_running.load();
-            });
-
-            if (!ios_engine_running.load()) break;
-
-            cmd = std::move(ios_command_queue.front());
-            ios_command_queue.pop_front();
-        }
+        if (cli.argc == 1 && !channel.wait_command(cmd))
+            break;
 
         std::istringstream is(cmd);
 
@@ -156,8 +219,8 @@ void UCIEngine::loop() {
             std::stringstream ss;
             ss << "id name " << engine_info(true) << "\n"
                << engine.get_options();
-            ios_post_output(ss.str());
-            ios_post_output("uciok");
+            channel.post(ss.str());
+            channel.post("uciok");
         }
 
         else if (token == "setoption")
@@ -171,12 +234,14 @@ void UCIEngine::loop() {
         }
         else if (token == "position")
             position(is);
+        else if (token == "reanalyze")
+            reanalyze(is);
         else if (token == "fen" || token == "startpos")
             is.seekg(0), position(is);
         else if (token == "ucinewgame")
             engine.search_clear();
         else if (token == "isready")
-            ios_post_output("readyok");
+            channel.post("readyok");
 
         // Add custom non-UCI commands, mainly for debugging purposes.
         else if (token == "flip")
@@ -185,12 +250,24 @@ void UCIEngine::loop() {
             bench(is);
         else if (token == BenchmarkCommand)
             benchmark(is);
+        else if (token == "chasebench")
+            chase_bench(is);
+        else if (token == "movegencheck")
+            movegen_check(is);
+        else if (token == "microbench")
+            microbench(is);
+#if defined(USE_FT_INT8)
+        else if (token == "ftcompare")
+            compare_ft_weights(is);
+#endif
+        else if (token == "tt")
+            tt_command(is);
         else if (token == "d")
-            ios_post_output(engine.visualize());
+            channel.post(engine.visualize());
         else if (token == "eval")
             engine.trace_eval();
         else if (token == "compiler")
-            ios_post_output(compiler_info());
+            channel.post(compiler_info());
         else if (token == "export_net")
         {
             std::pair<std::optional<std::string>, std::string> files;
@@ -203,11 +280,11 @@ void UCIEngine::loop() {
              std::stringstream ss;
              ss << "\nStockfish/Pikafish is a powerful chess engine..."
                 << "\nSee https://github.com/official-stockfish/Stockfish";
-             ios_post_output(ss.str());
+             channel.post(ss.str());
         }
         else if (!token.empty() && token[0] != '#') {
             std::string err = "Unknown command: '" + cmd + "'. Type help for more information.";
-            ios_post_output(err);
+            channel.post(err);
         }
         
         // Xóa cmd để tránh lặp lại vòng lặp
@@ -216,8 +293,7 @@ void UCIEngine::loop() {
     } while (token != "quit" && cli.argc == 1);
     
     // Dọn dẹp khi thoát
-    ios_engine_running.store(false);
-    ios_command_cv.notify_all();
+    channel.close();
 }
 
 Search::LimitsType UCIEngine::parse_limits(std::istream& is) {
@@ -251,6 +327,8 @@ Search::LimitsType UCIEngine::parse_limits(std::istream& is) {
             is >> limits.mate;
         else if (token == "perft")
             is >> limits.perft;
+        else if (token == "divide")
+            is >> limits.divideFile;
         else if (token == "infinite")
             limits.infinite = 1;
         else if (token == "ponder")
@@ -266,7 +344,32 @@ void UCIEngine::go(std::istringstream& is) {
     if (limits.perft)
         perft(limits);
     else
+    {
+        sync_binary_listeners();
         engine.go(limits);
+    }
+}
+
+// Installs or removes the binary search listeners registered over the C API.
+// The update context is read by the search thread, so only swap it while idle.
+void UCIEngine::sync_binary_listeners() {
+    engine.wait_for_search_finished();
+
+    if (auto onInfo = channel.info_listener())
+        engine.set_on_update_full_binary([this, onInfo](const Engine::InfoBinary& i) {
+            note_first_info();
+            onInfo(&i);
+        });
+    else
+        engine.set_on_update_full_binary(nullptr);
+
+    if (auto onBestmove = channel.bestmove_listener())
+        engine.set_on_bestmove_binary([this, onBestmove](Move bm, Move p) {
+            if (!interrupting)
+                onBestmove(bm.raw(), p.raw());
+        });
+    else
+        engine.set_on_bestmove_binary(nullptr);
 }
 
 // MODIFIED: Giữ nguyên logic Bench gốc, chỉ thay đổi Output cuối cùng
@@ -280,6 +383,8 @@ void UCIEngine::bench(std::istream& args) {
         nodesSearched = i.nodes;
         on_update_full(i, options["UCI_ShowWDL"]);
     });
+    engine.set_on_update_full_binary(nullptr);
+    engine.set_on_bestmove_binary(nullptr);
 
     std::vector<std::string> list = Benchmark::setup_bench(engine.fen(), args);
 
@@ -295,11 +400,11 @@ void UCIEngine::bench(std::istream& args) {
 
         if (token == "go" || token == "eval")
         {
-            // Thay thế std::cerr bằng ios_post_output để báo tiến độ
+            // Thay thế std::cerr bằng channel.post để báo tiến độ
             {
                 std::stringstream ss;
                 ss << "\nPosition: " << cnt++ << '/' << num << " (" << engine.fen() << ")";
-                ios_post_output(ss.str());
+                channel.post(ss.str());
             }
 
             if (token == "go")
@@ -335,18 +440,35 @@ void UCIEngine::bench(std::istream& args) {
 
     // MODIFIED: Gửi kết quả tổng hợp về App
     {
+        const auto [chaseHits, chaseMisses] = engine.get_chase_cache_stats();
+
         std::stringstream ss;
         ss << "\n==========================="
            << "\nTotal time (ms) : " << elapsed
            << "\nNodes searched  : " << nodes
-           << "\nNodes/second    : " << 1000 * nodes / elapsed;
-        ios_post_output(ss.str());
+           << "\nNodes/second    : " << 1000 * nodes / elapsed
+           << "\nChase cache     : " << chaseHits << " hits, " << chaseMisses << " misses"
+           << "\nPosition size   : " << sizeof(Position) << " bytes"
+           << "\nStateInfo size  : " << sizeof(StateInfo) << " bytes";
+        channel.post(ss.str());
     }
 
     engine.set_on_update_full([&](const auto& i) { on_update_full(i, options["UCI_ShowWDL"]); });
 }
 
 // MODIFIED: Giữ nguyên logic Benchmark gốc
+void UCIEngine::set_benchmark_listeners(std::uint64_t& nodesSearched) {
+    engine.set_on_update_full([&](const Engine::InfoFull& i) { nodesSearched = i.nodes; });
+
+    // Tắt các callback output khác để đỡ ồn khi benchmark
+    engine.set_on_iter([](const auto&) {});
+    engine.set_on_update_no_moves([](const auto&) {});
+    engine.set_on_bestmove([](const auto&, const auto&) {});
+    engine.set_on_verify_networks([](const auto&) {});
+    engine.set_on_update_full_binary(nullptr);
+    engine.set_on_bestmove_binary(nullptr);
+}
+
 void UCIEngine::benchmark(std::istream& args) {
     static constexpr int NUM_WARMUP_POSITIONS = 3;
 
@@ -354,13 +476,17 @@ void UCIEngine::benchmark(std::istream& args) {
     uint64_t    nodes = 0, cnt = 1;
     uint64_t    nodesSearched = 0;
 
-    engine.set_on_update_full([&](const Engine::InfoFull& i) { nodesSearched = i.nodes; });
+    // "speedtest scaling ..." runs the thread scaling mode instead
+    const auto start = args.tellg();
+    if (args >> token && token == "scaling")
+    {
+        benchmark_scaling(args);
+        return;
+    }
+    args.clear();
+    args.seekg(start);
 
-    // Tắt các callback output khác để đỡ ồn khi benchmark
-    engine.set_on_iter([](const auto&) {});
-    engine.set_on_update_no_moves([](const auto&) {});
-    engine.set_on_bestmove([](const auto&, const auto&) {});
-    engine.set_on_verify_networks([](const auto&) {});
+    set_benchmark_listeners(nodesSearched);
 
     Benchmark::BenchmarkSetup setup = Benchmark::setup_benchmark(args);
 
@@ -391,7 +517,7 @@ void UCIEngine::benchmark(std::istream& args) {
             {
                 std::stringstream ss;
                 ss << "\rWarmup position " << cnt++ << '/' << NUM_WARMUP_POSITIONS;
-                ios_post_output(ss.str());
+                channel.post(ss.str());
             }
 
             Search::LimitsType limits = parse_limits(is);
@@ -417,7 +543,7 @@ void UCIEngine::benchmark(std::istream& args) {
             break;
     }
 
-    ios_post_output("\n"); // Newline
+    channel.post("\n"); // Newline
 
     cnt   = 1;
     nodes = 0;
@@ -437,6 +563,8 @@ void UCIEngine::benchmark(std::istream& args) {
         }
     };
 
+    uint64_t evalCacheHits = 0, evalCacheMisses = 0;
+
     engine.search_clear();
 
     for (const auto& cmd : setup.commands)
@@ -450,11 +578,14 @@ void UCIEngine::benchmark(std::istream& args) {
             {
                 std::stringstream ss;
                 ss << "\rPosition " << cnt++ << '/' << numGoCommands;
-                ios_post_output(ss.str());
+                channel.post(ss.str());
             }
 
             Search::LimitsType limits = parse_limits(is);
 
+            // ucinewgame resets the counters, so sum them up per search
+            const auto [hitsBefore, missesBefore] = engine.get_eval_cache_stats();
+
             TimePoint elapsed = now();
 
             engine.go(limits);
@@ -464,6 +595,10 @@ void UCIEngine::benchmark(std::istream& args) {
 
             updateHashfullReadings();
 
+            const auto [hitsAfter, missesAfter] = engine.get_eval_cache_stats();
+            evalCacheHits += hitsAfter - hitsBefore;
+            evalCacheMisses += missesAfter - missesBefore;
+
             nodes += nodesSearched;
             nodesSearched = 0;
         }
@@ -479,7 +614,7 @@ void UCIEngine::benchmark(std::istream& args) {
 
     dbg_print();
 
-    ios_post_output("\n");
+    channel.post("\n");
 
     static_assert(std::size(hashfullAges) == 2 && hashfullAges[0] == 0 && hashfullAges[1] == 999,
                   "Hardcoded for display.");
@@ -501,32 +636,330 @@ void UCIEngine::benchmark(std::istream& args) {
            << "\nThread count               : " << setup.threads
            << "\nThread binding             : " << threadBinding
            << "\nTT size [MiB]              : " << setup.ttSize
+           << "\nPosition, StateInfo [B]    : " << sizeof(Position) << ", " << sizeof(StateInfo)
            << "\nHash max, avg [per mille]  : "
            << "\n    single search          : " << maxHashfull[0] << ", " << totalHashfull[0] / numHashfullReadings
            << "\n    single game            : " << maxHashfull[1] << ", " << totalHashfull[1] / numHashfullReadings
            << "\nTotal nodes searched       : " << nodes
            << "\nTotal search time [s]      : " << totalTime / 1000.0
-           << "\nNodes/second               : " << 1000 * nodes / totalTime;
-        ios_post_output(ss.str());
+           << "\nNodes/second               : " << 1000 * nodes / totalTime
+           << "\nEval cache hits, misses    : " << evalCacheHits << ", " << evalCacheMisses
+           << "\nEval cache hit rate [%]    : " << std::fixed << std::setprecision(1)
+           << 100.0 * evalCacheHits / std::max<uint64_t>(evalCacheHits + evalCacheMisses, 1);
+        channel.post(ss.str());
     }
 
     init_search_update_listeners();
 }
 
+// Searches the bench positions to a fixed depth at 1, 2, 4... threads, for
+// each hash size, and prints per run the time to depth, NPS, average hashfull
+// and the efficiency against one thread with the same hash as JSON.
+void UCIEngine::benchmark_scaling(std::istream& args) {
+
+    struct Run {
+        int       threads, hashMB, hashfull;
+        uint64_t  nodes;
+        TimePoint time;
+    };
+
+    uint64_t nodesSearched = 0;
+    set_benchmark_listeners(nodesSearched);
+
+    const Benchmark::ScalingSetup setup = Benchmark::setup_scaling(args);
+    const int numGoCommands             = int(setup.commands.size() / 2);
+
+    std::vector<Run> runs;
+
+    for (int hashMB : setup.hashSizes)
+        for (int threads : setup.threads)
+        {
+            Run run{threads, hashMB, 0, 0, 0};
+            int cnt = 1;
+
+            {
+                auto ss = std::istringstream("name Threads value " + std::to_string(threads));
+                setoption(ss);
+            }
+            {
+                auto ss = std::istringstream("name Hash value " + std::to_string(hashMB));
+                setoption(ss);
+            }
+            engine.search_clear();
+
+            for (const auto& cmd : setup.commands)
+            {
+                std::istringstream is(cmd);
+                std::string        token;
+                is >> std::skipws >> token;
+
+                if (token == "position")
+                {
+                    position(is);
+                    continue;
+                }
+
+                // Report Progress
+                {
+                    std::stringstream ss;
+                    ss << "\rThreads " << threads << ", hash " << hashMB << " MiB: position "
+                       << cnt++ << '/' << numGoCommands;
+                    channel.post(ss.str());
+                }
+
+                Search::LimitsType limits = parse_limits(is);
+
+                TimePoint elapsed = now();
+
+                engine.go(limits);
+                engine.wait_for_search_finished();
+
+                run.time += now() - elapsed;
+                run.hashfull += engine.get_hashfull(0);
+                run.nodes += nodesSearched;
+                nodesSearched = 0;
+            }
+
+            run.time = std::max<TimePoint>(run.time, 1);
+            run.hashfull /= std::max(numGoCommands, 1);
+            runs.push_back(run);
+        }
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3) << "{\n  \"depth\": " << setup.depth
+       << ",\n  \"positions\": " << numGoCommands << ",\n  \"runs\": [";
+
+    for (size_t i = 0; i < runs.size(); ++i)
+    {
+        const Run& r = runs[i];
+
+        // The first run of each hash size is the one with a single thread
+        const Run& base = *std::find_if(runs.begin(), runs.end(),
+                                        [&](const Run& b) { return b.hashMB == r.hashMB; });
+
+        const double nps     = 1000.0 * r.nodes / r.time;
+        const double baseNps = 1000.0 * base.nodes / base.time;
+        const double speedup = double(base.time) / r.time;
+
+        ss << (i ? "," : "") << "\n    {\"threads\": " << r.threads << ", \"hash_mb\": " << r.hashMB
+           << ", \"time_ms\": " << r.time << ", \"nodes\": " << r.nodes
+           << ", \"nps\": " << uint64_t(nps) << ", \"hashfull\": " << r.hashfull
+           << ", \"nps_efficiency\": " << nps / (baseNps * r.threads)
+           << ", \"ttd_speedup\": " << speedup
+           << ", \"ttd_efficiency\": " << speedup / r.threads << "}";
+    }
+
+    ss << "\n  ]\n}";
+    channel.post("\n");
+    channel.post(ss.str());
+
+    init_search_update_listeners();
+}
+
+// Runs rule_perft() over the chase bench positions without game rules, with
+// them, and with them and the chase verdict cache. The difference between the
+// first two runs is the cost of repetition and chase detection.
+void UCIEngine::chase_bench(std::istream& args) {
+    Depth depth = 5;
+    args >> depth;
+
+    auto chaseCache = std::make_unique<ChaseCache>();
+
+    for (int run = 0; run < 3; ++run)
+    {
+        uint64_t  nodes = 0, judged = 0;
+        TimePoint elapsed = now();
+
+        chaseCache->clear();
+
+        for (const auto& cmd : Benchmark::chase_bench_positions())
+        {
+            std::istringstream is(cmd);
+            std::string        token, fen;
+
+            is >> token;  // Consume the "fen" token
+            while (is >> token && token != "moves")
+                fen += token + " ";
+
+            StateListPtr states(new std::deque<StateInfo>(1));
+            Position     pos;
+            pos.set(fen, &states->back());
+
+            while (is >> token)
+            {
+                states->emplace_back();
+                pos.do_move(to_move(pos, token), states->back());
+            }
+            pos.fill_chased_history();
+
+            nodes += run == 0 ? Benchmark::rule_perft<false>(pos, depth, 0, nullptr, judged)
+                              : Benchmark::rule_perft<true>(
+                                  pos, depth, 0, run == 2 ? chaseCache.get() : nullptr, judged);
+        }
+
+        elapsed = now() - elapsed + 1;
+
+        std::stringstream ss;
+        ss << "\n==========================="
+           << "\nGame rules      : "
+           << (run == 0 ? "off" : run == 1 ? "on" : "on, chase verdict cache")
+           << "\nTotal time (ms) : " << elapsed
+           << "\nNodes searched  : " << nodes
+           << "\nNodes judged    : " << judged
+           << "\nNodes/second    : " << 1000 * nodes / elapsed;
+        if (run == 2)
+            ss << "\nCache lookups   : " << chaseCache->hits << " hits, " << chaseCache->misses
+               << " misses";
+        channel.post(ss.str());
+    }
+}
+
+// Compares generate<LEGAL> with the pseudo-legal moves that pass the legality
+// test, at every node of the bench positions up to the given depth (4 by
+// default). At the default depth the leaf count is also compared with the
+// count of a verified build, to catch changes to the legality test itself.
+//
+// movegencheck [depth]
+void UCIEngine::movegen_check(std::istream& args) {
+    constexpr int      DefaultDepth = 4;
+    constexpr uint64_t Signature    = 96582872;
+
+    int depth = DefaultDepth;
+    args >> depth;
+
+    TimePoint elapsed = now();
+    auto      result  = Benchmark::check_movegen(std::max(depth, 1));
+    elapsed           = now() - elapsed + 1;
+
+    const bool passed =
+      !result.mismatches && (depth != DefaultDepth || result.nodes == Signature);
+
+    std::stringstream ss;
+    ss << "\n==========================="
+       << "\nTotal time (ms) : " << elapsed
+       << "\nNodes           : " << result.nodes
+       << "\nMismatches      : " << result.mismatches;
+    if (depth == DefaultDepth)
+        ss << "\nExpected nodes  : " << Signature;
+    ss << "\nMove generation : " << (passed ? "ok" : "FAILED");
+
+    channel.post(ss.str());
+}
+
 void UCIEngine::setoption(std::istringstream& is) {
     engine.wait_for_search_finished();
     engine.get_options().setoption(is);
 }
 
+// Times the hot primitives in isolation and prints the result as JSON:
+//
+// microbench [runs <n>] [save <file>] [compare <file>]
+//
+// 'save' also writes the JSON to a file, 'compare' adds the ns/op of a saved
+// run and the change against it to each result.
+void UCIEngine::microbench(std::istream& args) {
+    int                           runs = 5;
+    std::string                   token, saveFile;
+    std::map<std::string, double> baseline;
+
+    while (args >> token)
+        if (token == "runs")
+            args >> runs;
+        else if (token == "save")
+            args >> saveFile;
+        else if (token == "compare" && args >> token)
+        {
+            std::ifstream file(token);
+            if (!file)
+                channel.post("info string Could not read " + token);
+            baseline = Benchmark::read_microbench(file);
+        }
+
+    const std::string json =
+      Benchmark::microbench_json(engine.microbench(std::max(runs, 1)), baseline);
+
+    if (!saveFile.empty() && !(std::ofstream(saveFile) << json << '\n'))
+        channel.post("info string Could not write " + saveFile);
+
+    channel.post(json);
+}
+
+#if defined(USE_FT_INT8)
+// Compares the network output, size and speed of the int8 feature transformer
+// weights of the loaded network with those of the int16 weights of the EvalFile
+// network, which it loads once more, about 86 MB, and frees when done. No cache
+// file is read or written. Only in builds with ftint8=yes:
+//
+// ftcompare [runs <n>]
+void UCIEngine::compare_ft_weights(std::istream& args) {
+    int         runs = 5;
+    std::string token;
+
+    while (args >> token)
+        if (token == "runs")
+            args >> runs;
+
+    channel.post(engine.compare_ft_weights(std::max(runs, 1)));
+}
+#endif
+
+// Saves the transposition table to a file, or loads one saved earlier:
+//
+// tt save <file>
+// tt load <file>
+//
+// A loaded table replaces the current one. Like any table, it is cleared by
+// "ucinewgame", while setting Hash or Threads moves its entries to a table of
+// the new size.
+void UCIEngine::tt_command(std::istream& args) {
+    std::string                token, file;
+    std::optional<std::string> error;
+
+    if (!(args >> token >> std::ws) || !std::getline(args, file) || file.empty()
+        || (token != "save" && token != "load"))
+    {
+        channel.post("info string Usage: tt save <file> | tt load <file>");
+        return;
+    }
+
+    error = token == "save" ? engine.save_tt(file) : engine.load_tt(file);
+
+    if (error)
+        channel.post("info string " + *error);
+    else if (token == "save")
+        channel.post("info string Transposition table saved to " + file);
+    else
+        channel.post("info string Transposition table loaded from " + file + ", "
+                     + std::string(engine.get_options()["Hash"]) + " MB");
+}
+
+// Runs perft on the current position. The count of each root move is
+// printed, or written to the file given with 'divide'.
 std::uint64_t UCIEngine::perft(const Search::LimitsType& limits) {
-    auto nodes = engine.perft(engine.fen(), limits.perft);
+    const auto start   = now();
+    const auto result  = engine.perft(engine.fen(), limits.perft);
+    const auto elapsed = now() - start + 1;  // Ensure positivity to avoid a 'divide by zero'
+
+    std::string divide;
+    for (const auto& [m, cnt] : result.divide)
+        divide += (divide.empty() ? "" : "\n") + move(m) + ": " + std::to_string(cnt);
+
+    if (limits.divideFile.empty())
+    {
+        if (!divide.empty())
+            channel.post(divide);
+    }
+    else if (!(std::ofstream(limits.divideFile) << divide << '\n'))
+        channel.post("info string Could not write " + limits.divideFile);
+
     // Report perft result
     {
         std::stringstream ss;
-        ss << "\nNodes searched: " << nodes;
-        ios_post_output(ss.str());
+        ss << "\nNodes searched: " << result.nodes
+           << "\nNodes/second  : " << 1000 * result.nodes / elapsed;
+        channel.post(ss.str());
     }
-    return nodes;
+    return result.nodes;
 }
 
 void UCIEngine::position(std::istringstream& is) {
@@ -542,6 +975,29 @@ void UCIEngine::position(std::istringstream& is) {
     else if (token == "fen")
         while (is >> token && token != "moves")
             fen += token + " ";
+    else if (token == "undo" || token == "append")
+    {
+        // Incremental update: "position [undo <plies>] [append <moves>]". A
+        // malformed command is rejected before the position is changed.
+        int plies = 0;
+        if (token == "undo" && (!(is >> plies) || plies < 0 || (is >> token && token != "append")))
+        {
+            channel.post("info string Invalid command, expected: position [undo <plies>] "
+                         "[append <moves>]");
+            return;
+        }
+
+        std::vector<std::string> moves;
+        while (is >> token)
+            moves.push_back(token);
+
+        engine.undo_moves(size_t(plies));
+
+        // Moves after an illegal one are not played either
+        if (const size_t played = engine.append_moves(moves); played < moves.size())
+            channel.post("info string Illegal move " + moves[played]);
+        return;
+    }
     else
         return;
 
@@ -552,6 +1008,107 @@ void UCIEngine::position(std::istringstream& is) {
     engine.set_position(fen, moves);
 }
 
+// Replaces "stop", "setoption name MultiPV/Skill Level", "position" and "go"
+// with a single command that joins the running search only once:
+//
+//   reanalyze [multipv <n>] [skill <level>] [startpos | fen <fen>] [moves <moves>]
+//             [undo <plies>] [append <moves>] [go <limits>]
+//
+// Without startpos/fen the current position is updated incrementally as with
+// "position undo/append". Without "go" the new search is infinite. The
+// interrupted search does not report a bestmove.
+void UCIEngine::reanalyze(std::istringstream& is) {
+    const auto start = now_us();
+
+    std::string              token, fen;
+    std::vector<std::string> moves;
+    size_t                   multiPV = 0, undo = 0;
+    int                      skill   = -1;
+    Search::LimitsType       limits;
+    bool                     hasLimits = false;
+
+    is >> token;
+    while (!token.empty() && !hasLimits)
+    {
+        std::string next;
+
+        if (token == "multipv")
+            is >> multiPV;
+        else if (token == "skill")
+            is >> skill;
+        else if (token == "undo")
+            is >> undo;
+        else if (token == "startpos")
+            fen = StartFEN;
+        else if (token == "fen")
+            while (is >> next && next != "moves" && next != "append" && next != "undo"
+                   && next != "multipv" && next != "skill" && next != "go")
+                fen += next + " ";
+        else if (token == "moves" || token == "append")
+            while (is >> next && next != "undo" && next != "multipv" && next != "skill"
+                   && next != "go")
+                moves.push_back(next);
+        else if (token == "go")
+        {
+            limits    = parse_limits(is);
+            hasLimits = true;
+        }
+
+        if (next.empty())
+            is >> next;
+        token = next;
+    }
+
+    if (!hasLimits)
+    {
+        limits.startTime = now();
+        limits.infinite  = 1;
+    }
+
+    // Interrupt and join the running search once, everything below is then
+    // applied to an idle engine
+    interrupting = true;
+    engine.stop();
+    engine.wait_for_search_finished();
+    interrupting = false;
+
+    if (!fen.empty())
+        engine.set_position(fen, moves);
+    else
+    {
+        engine.undo_moves(undo);
+        engine.append_moves(moves);
+    }
+
+    auto& options = engine.get_options();
+    if (multiPV && size_t(options["MultiPV"]) != multiPV)
+    {
+        std::istringstream ss("name MultiPV value " + std::to_string(multiPV));
+        options.setoption(ss);
+    }
+
+    if (skill >= 0 && int(options["Skill Level"]) != skill)
+    {
+        std::istringstream ss("name Skill Level value " + std::to_string(skill));
+        options.setoption(ss);
+    }
+
+    if (limits.perft)
+        return;
+
+    reanalyzeStartUs = start;
+    sync_binary_listeners();
+    engine.go(limits);
+}
+
+void UCIEngine::note_first_info() {
+    if (!reanalyzeStartUs.load(std::memory_order_relaxed))
+        return;
+
+    if (const auto start = reanalyzeStartUs.exchange(0))
+        channel.record_first_info(std::uint64_t(now_us() - start));
+}
+
 namespace {
 // ... (WinRateParams giữ nguyên) ...
 struct WinRateParams {
@@ -622,15 +1179,17 @@ Move UCIEngine::to_move(const Position& pos, std::string str) {
 }
 
 // MODIFIED: CÁC HÀM CALLBACK UPDATE THÔNG TIN
-// Thay thế sync_cout bằng ios_post_output
+// Thay thế sync_cout bằng channel.post
 
 void UCIEngine::on_update_no_moves(const Engine::InfoShort& info) {
     std::stringstream ss;
     ss << "info depth " << info.depth << " score " << format_score(info.score);
-    ios_post_output(ss.str());
+    channel.post(ss.str());
 }
 
 void UCIEngine::on_update_full(const Engine::InfoFull& info, bool showWDL) {
+    note_first_info();
+
     std::stringstream ss;
 
     ss << "info";
@@ -652,7 +1211,7 @@ void UCIEngine::on_update_full(const Engine::InfoFull& info, bool showWDL) {
        << " time " << info.timeMs
        << " pv " << info.pv;
 
-    ios_post_output(ss.str());
+    channel.post(ss.str());
 }
 
 void UCIEngine::on_iter(const Engine::InfoIter& info) {
@@ -661,15 +1220,18 @@ void UCIEngine::on_iter(const Engine::InfoIter& info) {
     ss << " depth " << info.depth
        << " currmove " << info.currmove
        << " currmovenumber " << info.currmovenumber;
-    ios_post_output(ss.str());
+    channel.post(ss.str());
 }
 
 void UCIEngine::on_bestmove(std::string_view bestmove, std::string_view ponder) {
+    if (interrupting)
+        return;
+
     // Fix lỗi string_view cho Xcode
     std::string out = "bestmove " + std::string(bestmove);
     if (!ponder.empty())
         out += " ponder " + std::string(ponder);
-    ios_post_output(out);
+    channel.post(out);
 }
 
 }  // namespace Stockfish
\ No newline at end of file
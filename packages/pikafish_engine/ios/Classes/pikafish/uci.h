@@ -6,8 +6,13 @@
 #ifndef UCI_H_INCLUDED
 #define UCI_H_INCLUDED
 
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <string_view>
 
@@ -23,9 +28,59 @@ class Score;
 enum Square : int8_t;
 using Value = int;
 
+// Command queue and output sink of one embedded engine instance, used in
+// place of stdin/stdout when the engine runs as a library. Commands are pushed
+// by the host, output lines are handed to the sink from the UCI loop thread
+// and from the search thread.
+class UCIChannel {
+   public:
+    using Sink             = std::function<void(const char*)>;
+    using InfoListener     = void (*)(const void* info);
+    using BestmoveListener = void (*)(std::uint16_t bestmove, std::uint16_t ponder);
+
+    explicit UCIChannel(Sink s) :
+        sink(std::move(s)) {}
+
+    void push_command(std::string cmd);
+    // Blocks until a command is available, returns false once closed
+    bool wait_command(std::string& cmd);
+    void open();
+    void close();
+
+    void post(const std::string& msg) const;
+
+    // Binary search listeners, see Search::InfoFullBinary
+    void set_search_listener(InfoListener onInfo, BestmoveListener onBestmove);
+    InfoListener     info_listener() const { return infoListener; }
+    BestmoveListener bestmove_listener() const { return bestmoveListener; }
+
+    // Time from a "reanalyze" command to the first PV of the search it
+    // starts, in microseconds
+    struct LatencyStats {
+        std::uint64_t count, lastUs, maxUs, totalUs;
+    };
+    void         record_first_info(std::uint64_t us);
+    LatencyStats first_info_stats() const;
+
+   private:
+    Sink                    sink;
+    std::deque<std::string> commands;
+    std::mutex              mutex;
+    std::condition_variable cv;
+    bool                    running = false;
+
+    std::atomic<InfoListener>     infoListener{nullptr};
+    std::atomic<BestmoveListener> bestmoveListener{nullptr};
+
+    std::atomic<std::uint64_t> firstInfoCount{0}, firstInfoLastUs{0}, firstInfoMaxUs{0},
+      firstInfoTotalUs{0};
+};
+
 class UCIEngine {
    public:
+    // Uses the process-wide channel fed by uci_inject_command()
     UCIEngine(int argc, char** argv);
+    UCIEngine(int argc, char** argv, UCIChannel& channel);
 
     void loop();
 
@@ -39,26 +94,45 @@ class UCIEngine {
     static Search::LimitsType parse_limits(std::istream& is);
 
     auto& engine_options() { return engine.get_options(); }
+    void  stash_networks() const { engine.stash_networks(); }
 
    private:
     Engine      engine;
     CommandLine cli;
+    UCIChannel& channel;
 
-    static void print_info_string(std::string_view str);
+    void print_info_string(std::string_view str);
 
     void          go(std::istringstream& is);
     void          bench(std::istream& args);
     void          benchmark(std::istream& args);
+    void          benchmark_scaling(std::istream& args);
+    void          set_benchmark_listeners(std::uint64_t& nodesSearched);
+    void          chase_bench(std::istream& args);
+    void          movegen_check(std::istream& args);
+    void          microbench(std::istream& args);
+#if defined(USE_FT_INT8)
+    void          compare_ft_weights(std::istream& args);
+#endif
+    void          tt_command(std::istream& args);
     void          position(std::istringstream& is);
+    void          reanalyze(std::istringstream& is);
     void          setoption(std::istringstream& is);
     std::uint64_t perft(const Search::LimitsType&);
 
-    static void on_update_no_moves(const Engine::InfoShort& info);
-    static void on_update_full(const Engine::InfoFull& info, bool showWDL);
-    static void on_iter(const Engine::InfoIter& info);
-    static void on_bestmove(std::string_view bestmove, std::string_view ponder);
+    void on_update_no_moves(const Engine::InfoShort& info);
+    void on_update_full(const Engine::InfoFull& info, bool showWDL);
+    void on_iter(const Engine::InfoIter& info);
+    void on_bestmove(std::string_view bestmove, std::string_view ponder);
 
     void init_search_update_listeners();
+    void sync_binary_listeners();
+
+    // Request time of the last reanalyze, cleared by the first PV it produces
+    std::atomic<std::int64_t> reanalyzeStartUs{0};
+    // Set while reanalyze joins the search it replaces, hides its bestmove
+    std::atomic<bool> interrupting{false};
+    void              note_first_info();
 };
 
 }  // namespace Stockfish
@@ -80,6 +154,16 @@ void uci_inject_command(const char* cmd);
 // Engine gọi để ghi output ra buffer (ios_bridge.mm định nghĩa)
 void write_to_dart_buffer(const char* text);
 
+// Listener nhị phân: 'info' trỏ tới Search::InfoFullBinary, move là Move::raw().
+// Khi đã đăng ký, engine bỏ qua việc format text cho info/bestmove.
+// Áp dụng từ lệnh 'go' kế tiếp; truyền nullptr để quay lại output text.
+typedef void (*uci_info_listener)(const void* info);
+typedef void (*uci_bestmove_listener)(uint16_t bestmove, uint16_t ponder);
+void uci_set_search_listener(uci_info_listener onInfo, uci_bestmove_listener onBestmove);
+
+// Độ trễ (micro giây) từ lệnh 'reanalyze' tới dòng info PV đầu tiên của search mới
+void uci_get_reanalyze_stats(uint64_t* count, uint64_t* lastUs, uint64_t* maxUs, uint64_t* totalUs);
+
 #ifdef __cplusplus
 }
 #endif
@@ -17,14 +17,146 @@ extern "C" {
 PIKAFISH_EXPORT
 void init_pikafish_ios();
 
+// Tắt Engine: dừng search, chờ thread engine kết thúc, giải phóng TT,
+// network và các thread search. Sau đó có thể gọi lại init_pikafish_ios.
+// keepNetwork != 0: giữ network đã giải nén để lần init sau không phải đọc lại.
+PIKAFISH_EXPORT
+void shutdown_pikafish_ios(int keepNetwork);
+
+// Đưa network NNUE có sẵn trong bộ nhớ (nội dung file .nnue, nén zstd hoặc
+// không, ví dụ asset đã mmap) cho engine, thay cho file tên name (NULL: tên
+// mặc định "pikafish.nnue"). Gọi trước init_pikafish_ios để engine nạp network
+// ngay khi khởi động, không cần copy asset ra file và gửi "setoption name
+// EvalFile". Network được giải nén thẳng vào bộ nhớ của engine, không qua bản
+// sao trung gian. Vùng nhớ phải còn hợp lệ cho tới khi gọi lại với data NULL.
+PIKAFISH_EXPORT
+void set_network_buffer_ios(const char* name, const void* data, uint64_t size);
+
+// Thư mục để engine ghi cache của network đã giải nén (mặc định của option
+// EvalFileCache), NULL hoặc "" để tắt cache (mặc định). Gọi trước
+// init_pikafish_ios. Lần nạp đầu ghi file cache khoảng 90 MB (network 9 MB,
+// weights int16), các lần sau đọc cache thay vì giải nén. Nên dùng thư mục
+// cache của App để hệ điều hành có thể xoá khi thiếu chỗ; thư mục không ghi
+// được thì engine chỉ bỏ qua cache.
+PIKAFISH_EXPORT
+void set_network_cache_dir_ios(const char* dir);
+
 // Gửi lệnh UCI
 PIKAFISH_EXPORT
 void send_command_ios(const char* cmd);
 
-// Đọc stdout từ engine
+// Cập nhật position tăng dần, giữ lịch sử ván để engine xét lặp/đuổi/chiếu mãi.
+// moves: các nước UCI cách nhau bởi dấu cách, đi tiếp từ position hiện tại.
+// Tương đương "position append <moves>".
+PIKAFISH_EXPORT
+void position_append_ios(const char* moves);
+
+// Lùi lại plies nước (không lùi quá position gốc của lệnh position fen/startpos).
+// Tương đương "position undo <plies>".
+PIKAFISH_EXPORT
+void position_undo_ios(int plies);
+
+// Thống kê độ trễ (micro giây) từ lệnh "reanalyze" tới dòng info PV đầu tiên
+// của search mới: số lần đo, lần gần nhất, lớn nhất và tổng. Con trỏ có thể NULL.
+PIKAFISH_EXPORT
+void get_reanalyze_stats_ios(uint64_t* count, uint64_t* lastUs, uint64_t* maxUs, uint64_t* totalUs);
+
+// Đọc stdout từ engine (một dòng mỗi lần gọi, không kèm '\n')
 PIKAFISH_EXPORT
 int read_stdout_ios(char* buffer, int maxLen);
 
+// Đọc tất cả các dòng đang chờ trong một lần gọi, mỗi dòng kết thúc bằng '\n'.
+// Trả về số byte đã ghi (không tính '\0').
+PIKAFISH_EXPORT
+int read_all_stdout_ios(char* buffer, int maxLen);
+
+// Số dòng output bị bỏ do ring buffer đầy và số lần bị tràn
+PIKAFISH_EXPORT
+void get_output_stats_ios(uint64_t* droppedLines, uint64_t* overflows);
+
+// ===== OUTPUT NOTIFICATION =====
+// Thay cho polling: engine báo khi có output mới. Các lần báo được gộp lại
+// (một loạt dòng chỉ báo một lần) cho tới khi App gọi read_stdout_ios /
+// read_all_stdout_ios, vì vậy mỗi lần được báo phải đọc cho tới khi hàm đọc
+// trả về 0.
+typedef void (*PikafishOutputCallback)(void);
+
+// Callback chạy trên thread của engine, phải trả về ngay (ví dụ callback từ
+// NativeCallable.listener của Dart). Truyền NULL để huỷ.
+PIKAFISH_EXPORT
+void set_output_callback_ios(PikafishOutputCallback cb);
+
+// File descriptor (đầu đọc của pipe, non-blocking) trở nên readable khi có
+// output mới, dùng với poll/epoll/kqueue. Trả về -1 nếu không tạo được pipe.
+PIKAFISH_EXPORT
+int get_output_notify_fd_ios();
+
+// ===== BINARY SEARCH INFO =====
+// Thông tin search dạng struct cố định (thay cho dòng "info ... pv ...").
+// Move 16-bit: from = move >> 7, to = move & 0x7F, ô = file + 9 * rank
+// (a0 = 0, i9 = 89). Layout phải khớp Search::InfoFullBinary trong search.h.
+#define PIKAFISH_MAX_PV 246
+
+enum {
+    PIKAFISH_SCORE_CP   = 0,
+    PIKAFISH_SCORE_MATE = 1  // score = số nước tới chiếu bí (âm nếu bị chiếu bí)
+};
+
+enum {
+    PIKAFISH_BOUND_EXACT = 0,
+    PIKAFISH_BOUND_LOWER = 1,
+    PIKAFISH_BOUND_UPPER = 2
+};
+
+typedef struct {
+    int32_t  depth;
+    int32_t  seldepth;
+    int32_t  multipv;
+    int32_t  score_type;
+    int32_t  score;
+    int32_t  bound;
+    int32_t  hashfull;
+    int32_t  pv_length;
+    uint64_t time_ms;
+    uint64_t nodes;
+    uint64_t nps;
+    uint16_t pv[PIKAFISH_MAX_PV];
+} PikafishSearchInfo;
+
+typedef void (*PikafishInfoCallback)(const PikafishSearchInfo* info);
+// ponder = 0 nếu không có
+typedef void (*PikafishBestmoveCallback)(uint16_t bestmove, uint16_t ponder);
+
+// Đăng ký listener nhị phân, có hiệu lực từ lệnh "go" kế tiếp. Khi đã đăng ký,
+// engine không gửi dòng "info ... pv" và "bestmove" dạng text nữa.
+// Truyền NULL cho cả hai để quay lại output text. Callback chạy trên thread
+// search, phải trả về nhanh.
+PIKAFISH_EXPORT
+void set_search_listener_ios(PikafishInfoCallback onInfo, PikafishBestmoveCallback onBestmove);
+
+// ===== MULTI-INSTANCE API =====
+// Nhiều engine độc lập trong cùng một process: mỗi handle có position,
+// option, hàng đợi lệnh và output riêng. Network NNUE giống nhau chỉ nạp
+// một bản trong bộ nhớ. Các hàm *_ios ở trên dùng engine mặc định.
+typedef struct pikafish_engine pikafish_engine_t;
+
+// Tạo engine mới và chạy vòng lặp UCI trên thread riêng
+PIKAFISH_EXPORT
+pikafish_engine_t* engine_create(void);
+
+// Gửi một lệnh UCI tới engine
+PIKAFISH_EXPORT
+void engine_send(pikafish_engine_t* engine, const char* cmd);
+
+// Đọc tất cả các dòng output đang chờ, mỗi dòng kết thúc bằng '\n'.
+// Trả về số byte đã ghi (không tính '\0').
+PIKAFISH_EXPORT
+int engine_read(pikafish_engine_t* engine, char* buffer, int maxLen);
+
+// Gửi "quit", chờ thread engine kết thúc rồi giải phóng handle
+PIKAFISH_EXPORT
+void engine_destroy(pikafish_engine_t* engine);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,62 +1,196 @@
-#import "pikafish_bridge.h"
+#include "pikafish_bridge.h"
 
 #include <atomic>
 #include <thread>
 #include <mutex>
-#include <queue>
 #include <string>
 #include <condition_variable>
+#include <cstddef>
 #include <cstdio>
 #include <cstring>
-#include <algorithm> // Để dùng std::min
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "pikafish_output_ring.h"
 
 // ===== UCI CORE =====
 // Đảm bảo file uci.h nằm đúng trong đường dẫn HEADER_SEARCH_PATHS
+#include "bitboard.h"
+#include "evaluate.h"
+#include "nnue/network.h"
+#include "position.h"
 #include "uci.h" 
 
 // ===== GLOBAL STATE =====
 static std::thread engineThread;
 static std::atomic<bool> engineStarted(false);
+// Giữ network cho lần init_pikafish_ios tiếp theo khi tắt engine
+static std::atomic<bool> keepNetworkOnQuit(false);
+// Serialize init/shutdown (App có thể gọi từ nhiều isolate)
+static std::mutex lifecycleMutex;
+
+// Output của một engine: ring SPSC 256 KB, không cấp phát bộ nhớ khi ghi
+struct EngineOutput {
+    OutputRing<1 << 18> ring;
+    // Chỉ serialize phía ghi (thread UCI và thread search), không khoá phía đọc
+    std::atomic_flag writeLock = ATOMIC_FLAG_INIT;
 
-// Output queue
-static std::mutex outputMutex;
-static std::queue<std::string> outputQueue;
+    void write(const char* text) {
+        while (writeLock.test_and_set(std::memory_order_acquire)) {}
+        ring.push(text, strlen(text));
+        writeLock.clear(std::memory_order_release);
+    }
+};
+
+static EngineOutput output;
 
 // Command mutex
 static std::mutex commandMutex;
 
+// ===== OUTPUT NOTIFICATION =====
+// Báo cho App khi có output mới thay vì để App polling. Chỉ báo một lần cho
+// đến khi App đọc lại (coalescing), nên một loạt dòng chỉ gây một lần wakeup.
+static std::atomic<bool> outputNotifyPending(false);
+static std::atomic<PikafishOutputCallback> outputCallback(nullptr);
+static std::once_flag outputPipeOnce;
+static int outputPipe[2] = {-1, -1};
+
+static void notify_output_available() {
+    if (outputNotifyPending.exchange(true))
+        return;
+
+    if (auto cb = outputCallback.load())
+        cb();
+
+    if (outputPipe[1] >= 0)
+    {
+        const char one = 1;
+        (void)!write(outputPipe[1], &one, 1);  // Pipe đầy nghĩa là đã có wakeup chờ
+    }
+}
+
+// Gọi ở đầu mỗi lần đọc: cho phép báo lần tiếp theo và xả byte trong pipe
+static void rearm_output_notification() {
+    outputNotifyPending.store(false);
+
+    if (outputPipe[0] >= 0)
+    {
+        char drain[64];
+        while (read(outputPipe[0], drain, sizeof(drain)) > 0) {}
+    }
+}
+
 // ===== CALLBACK TỪ ENGINE =====
 // Hàm này engine C++ sẽ gọi để bắn log ra ngoài
 extern "C" void write_to_dart_buffer(const char* text) {
     if (!text) return;
 
-    std::lock_guard<std::mutex> lock(outputMutex);
-    outputQueue.emplace(text);
+    output.write(text);
+    notify_output_available();
     
     // printf("[ENGINE -> APP] %s\n", text); // Uncomment nếu cần debug log
 }
 
+// ===== BINARY SEARCH INFO =====
+using BinaryInfo = Stockfish::Search::InfoFullBinary;
+
+static_assert(sizeof(PikafishSearchInfo) == sizeof(BinaryInfo), "layout mismatch");
+static_assert(PIKAFISH_MAX_PV == Stockfish::MAX_PLY, "layout mismatch");
+static_assert(offsetof(PikafishSearchInfo, time_ms) == offsetof(BinaryInfo, timeMs), "layout mismatch");
+static_assert(offsetof(PikafishSearchInfo, pv) == offsetof(BinaryInfo, pv), "layout mismatch");
+
+static std::atomic<PikafishInfoCallback>     infoCallback(nullptr);
+static std::atomic<PikafishBestmoveCallback> bestmoveCallback(nullptr);
+
+static void forward_info(const void* info) {
+    if (auto cb = infoCallback.load())
+        cb(static_cast<const PikafishSearchInfo*>(info));
+}
+
+static void forward_bestmove(uint16_t bestmove, uint16_t ponder) {
+    if (auto cb = bestmoveCallback.load())
+        cb(bestmove, ponder);
+}
+
 // ===== ENGINE THREAD =====
+// Bảng bitboard/zobrist dùng chung cho mọi engine trong process, chỉ khởi tạo một lần
+static void init_engine_tables() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        Stockfish::Bitboards::init();
+        Stockfish::Position::init();
+    });
+}
+
 static void engine_main() {
-    char* argv[] = {(char*)"pikafish", nullptr};
+    char name[] = "pikafish";
+    char* argv[] = {name, nullptr};
     int argc = 1;
 
+    init_engine_tables();
+
     // Khởi tạo Engine
     Stockfish::UCIEngine engine(argc, argv);
-    engine.loop(); // Vòng lặp vô tận của engine
+    engine.loop(); // Chạy đến khi nhận "quit"
+
+    if (keepNetworkOnQuit.load())
+        engine.stash_networks();
+
+    // "quit" cũng có thể đến từ send_command_ios, cho phép init lại
+    engineStarted = false;
+    // Ra khỏi scope: dừng search, join các thread search, giải phóng TT và network
 }
 
+// ===== MULTI-INSTANCE =====
+// Mỗi handle có hàng đợi lệnh, output và thread UCI riêng. Network NNUE giống
+// nhau được dùng chung qua LazyNumaReplicatedSystemWide (dedup theo nội dung).
+struct pikafish_engine {
+    EngineOutput            output;
+    Stockfish::UCIChannel   channel;
+    std::thread             thread;
+
+    pikafish_engine() :
+        channel([this](const char* text) { output.write(text); }) {}
+};
+
 // ===== EXPORTED C API =====
 // Các hàm này PHẢI khớp tên với pikafish_bridge.h và pikafish_force_link.mm
 extern "C" {
 
 void init_pikafish_ios() {
+    std::lock_guard<std::mutex> lock(lifecycleMutex);
     if (engineStarted.exchange(true)) {
         return;
     }
+    // Thread cũ đã thoát vì "quit" nhưng chưa được join
+    if (engineThread.joinable()) {
+        engineThread.join();
+    }
     printf("[iOS Bridge] Starting Pikafish engine thread...\n");
     engineThread = std::thread(engine_main);
-    engineThread.detach(); // Tách thread để chạy ngầm
+}
+
+void shutdown_pikafish_ios(int keepNetwork) {
+    std::lock_guard<std::mutex> lock(lifecycleMutex);
+    if (!engineThread.joinable()) {
+        return;
+    }
+    printf("[iOS Bridge] Stopping Pikafish engine thread...\n");
+    keepNetworkOnQuit = keepNetwork != 0;
+    if (engineStarted.load()) {
+        std::lock_guard<std::mutex> cmdLock(commandMutex);
+        uci_inject_command("quit");
+    }
+    engineThread.join();
+}
+
+void set_network_buffer_ios(const char* name, const void* data, uint64_t size) {
+    Stockfish::Eval::NNUE::register_network_buffer(name ? name : EvalFileDefaultNameBig, data,
+                                                   (size_t)size);
+}
+
+void set_network_cache_dir_ios(const char* dir) {
+    Stockfish::Eval::NNUE::set_network_cache_directory(dir ? dir : "");
 }
 
 void send_command_ios(const char* cmd) {
@@ -67,21 +201,105 @@ void send_command_ios(const char* cmd) {
     uci_inject_command(cmd); 
 }
 
+void position_append_ios(const char* moves) {
+    if (!moves || !*moves) return;
+    send_command_ios(("position append " + std::string(moves)).c_str());
+}
+
+void position_undo_ios(int plies) {
+    if (plies <= 0) return;
+    send_command_ios(("position undo " + std::to_string(plies)).c_str());
+}
+
+void get_reanalyze_stats_ios(uint64_t* count, uint64_t* lastUs, uint64_t* maxUs, uint64_t* totalUs) {
+    uci_get_reanalyze_stats(count, lastUs, maxUs, totalUs);
+}
+
+void set_search_listener_ios(PikafishInfoCallback onInfo, PikafishBestmoveCallback onBestmove) {
+    infoCallback.store(onInfo);
+    bestmoveCallback.store(onBestmove);
+    uci_set_search_listener(onInfo ? forward_info : nullptr,
+                            onBestmove ? forward_bestmove : nullptr);
+}
+
 int read_stdout_ios(char* buffer, int maxLen) {
     if (!buffer || maxLen <= 1) return 0;
 
-    std::lock_guard<std::mutex> lock(outputMutex);
+    rearm_output_notification();
+    return (int)output.ring.pop(buffer, (size_t)maxLen, false);
+}
+
+int read_all_stdout_ios(char* buffer, int maxLen) {
+    if (!buffer || maxLen <= 1) return 0;
+
+    rearm_output_notification();
+    return (int)output.ring.pop(buffer, (size_t)maxLen, true);
+}
+
+void set_output_callback_ios(PikafishOutputCallback cb) {
+    outputCallback.store(cb);
+
+    // Output đã có sẵn trước khi đăng ký cũng phải được báo
+    if (cb && !output.ring.empty() && !outputNotifyPending.exchange(true))
+        cb();
+}
+
+int get_output_notify_fd_ios() {
+    std::call_once(outputPipeOnce, [] {
+        int fds[2];
+        if (pipe(fds) < 0) return;
+
+        for (int fd : fds)
+        {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+        outputPipe[0] = fds[0];
+        outputPipe[1] = fds[1];
 
-    if (outputQueue.empty()) return 0;
+        if (!output.ring.empty())
+        {
+            outputNotifyPending.store(true);
+            const char one = 1;
+            (void)!write(outputPipe[1], &one, 1);
+        }
+    });
+    return outputPipe[0];
+}
+
+void get_output_stats_ios(uint64_t* droppedLines, uint64_t* overflows) {
+    if (droppedLines) *droppedLines = output.ring.dropped_lines();
+    if (overflows) *overflows = output.ring.overflow_count();
+}
+
+pikafish_engine_t* engine_create() {
+    init_engine_tables();
 
-    std::string line = outputQueue.front();
-    outputQueue.pop();
+    auto* e = new pikafish_engine();
+    e->thread = std::thread([e] {
+        char name[] = "pikafish";
+        char* argv[] = {name, nullptr};
+        Stockfish::UCIEngine engine(1, argv, e->channel);
+        engine.loop();
+    });
+    return e;
+}
+
+void engine_send(pikafish_engine_t* e, const char* cmd) {
+    if (!e || !cmd) return;
+    e->channel.push_command(cmd);
+}
 
-    int len = std::min((int)line.size(), maxLen - 1);
-    memcpy(buffer, line.c_str(), len);
-    buffer[len] = '\0'; // Null-terminate string
+int engine_read(pikafish_engine_t* e, char* buffer, int maxLen) {
+    if (!e || !buffer || maxLen <= 1) return 0;
+    return (int)e->output.ring.pop(buffer, (size_t)maxLen, true);
+}
 
-    return len;
+void engine_destroy(pikafish_engine_t* e) {
+    if (!e) return;
+    e->channel.push_command("quit");
+    e->thread.join();
+    delete e;
 }
 
 } // End extern "C"
\ No newline at end of file
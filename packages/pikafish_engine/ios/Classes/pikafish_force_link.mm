@@ -19,9 +19,24 @@ void pikafish_force_link_symbols(void) {
     // Gọi các hàm thực tế hiện có trong bridge
     // Chú ý: các lời gọi này không cần có logic thực sự; chỉ để tạo reference cho linker
     init_pikafish_ios();
+    shutdown_pikafish_ios(1);
+    set_network_buffer_ios(nullptr, nullptr, 0);
+    set_network_cache_dir_ios(nullptr);
     send_command_ios("uci");
+    position_append_ios("");
+    position_undo_ios(0);
+    get_reanalyze_stats_ios(nullptr, nullptr, nullptr, nullptr);
     // gọi read để chắc chắn symbol/read-line được giữ; truyền buffer NULL là OK theo impl
     read_stdout_ios(nullptr, 0);
+    read_all_stdout_ios(nullptr, 0);
+    get_output_stats_ios(nullptr, nullptr);
+    set_search_listener_ios(nullptr, nullptr);
+    set_output_callback_ios(nullptr);
+    get_output_notify_fd_ios();
+    pikafish_engine_t* engine = engine_create();
+    engine_send(engine, "uci");
+    engine_read(engine, nullptr, 0);
+    engine_destroy(engine);
 }
 
 #ifdef __cplusplus
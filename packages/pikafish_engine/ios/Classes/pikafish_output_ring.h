@@ -0,0 +1,122 @@
+#ifndef PIKAFISH_OUTPUT_RING_H
+#define PIKAFISH_OUTPUT_RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Fixed-capacity single-producer/single-consumer byte ring for engine output.
+// Every line is stored as its bytes followed by '\n', so nothing is allocated
+// on the hot path. Read and write positions are free-running counters that are
+// masked on access, hence Capacity must be a power of two.
+//
+// The producer side must be serialized by the caller: the UCI loop thread and
+// the search thread can both print, but they never contend with the consumer.
+template<size_t Capacity>
+class OutputRing {
+    static_assert(Capacity && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+
+    static constexpr size_t Mask = Capacity - 1;
+
+   public:
+    // Appends one line. When the line does not fit, it is dropped whole so the
+    // reader never sees a partial line.
+    bool push(const char* text, size_t len) {
+        const size_t head = writePos.load(std::memory_order_relaxed);
+        const size_t tail = readPos.load(std::memory_order_acquire);
+
+        if (len + 1 > Capacity - (head - tail))
+        {
+            droppedLines.fetch_add(1, std::memory_order_relaxed);
+            if (!overflowing)
+                overflows.fetch_add(1, std::memory_order_relaxed);
+            overflowing = true;
+            return false;
+        }
+
+        overflowing = false;
+        copy_in(head, text, len);
+        buffer[(head + len) & Mask] = '\n';
+        writePos.store(head + len + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Copies complete lines into 'out' and NUL-terminates it. With 'batch'
+    // set, every pending line that fits is returned in one call, each with
+    // its '\n' terminator. Otherwise only the first line is returned, without
+    // it. A line longer than 'out' is truncated. Returns the number of bytes
+    // written, excluding the NUL.
+    size_t pop(char* out, size_t maxLen, bool batch) {
+        if (!out || maxLen <= 1)
+            return 0;
+
+        const size_t tail  = readPos.load(std::memory_order_relaxed);
+        const size_t head  = writePos.load(std::memory_order_acquire);
+        const size_t avail = head - tail;
+
+        if (!avail)
+            return 0;
+
+        size_t take = 0, consumed = 0;
+
+        if (batch)
+        {
+            // Cut back to the last complete line that fits
+            take = std::min(avail, maxLen - 1);
+            while (take && buffer[(tail + take - 1) & Mask] != '\n')
+                --take;
+            consumed = take;
+        }
+
+        if (!take)
+        {
+            // Single line, or a first line too long for 'out': return its
+            // head without the terminator and skip the rest.
+            size_t end = 0;
+            while (end < avail && buffer[(tail + end) & Mask] != '\n')
+                ++end;
+            take     = std::min(end, maxLen - 1);
+            consumed = end + 1;
+        }
+
+        copy_out(tail, out, take);
+        out[take] = '\0';
+        readPos.store(tail + consumed, std::memory_order_release);
+        return take;
+    }
+
+    bool empty() const {
+        return readPos.load(std::memory_order_acquire) == writePos.load(std::memory_order_acquire);
+    }
+
+    uint64_t dropped_lines() const { return droppedLines.load(std::memory_order_relaxed); }
+    uint64_t overflow_count() const { return overflows.load(std::memory_order_relaxed); }
+
+   private:
+    void copy_in(size_t pos, const char* src, size_t len) {
+        const size_t off   = pos & Mask;
+        const size_t first = std::min(len, Capacity - off);
+        std::memcpy(buffer + off, src, first);
+        std::memcpy(buffer, src + first, len - first);
+    }
+
+    void copy_out(size_t pos, char* dst, size_t len) const {
+        const size_t off   = pos & Mask;
+        const size_t first = std::min(len, Capacity - off);
+        std::memcpy(dst, buffer + off, first);
+        std::memcpy(dst + first, buffer, len - first);
+    }
+
+    alignas(64) std::atomic<size_t> writePos{0};
+    std::atomic<uint64_t> droppedLines{0};
+    std::atomic<uint64_t> overflows{0};
+    bool                  overflowing = false;
+
+    alignas(64) std::atomic<size_t> readPos{0};
+
+    alignas(64) char buffer[Capacity];
+};
+
+#endif  // PIKAFISH_OUTPUT_RING_H
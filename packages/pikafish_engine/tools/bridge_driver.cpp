@@ -0,0 +1,217 @@
+/*
+  Chạy engine qua C API của pikafish_bridge.h (như App gọi qua FFI), gửi một
+  phiên UCI theo kịch bản rồi đo độ trễ lệnh -> phản hồi và thông lượng output.
+
+  Build (Linux):
+
+    cd packages/pikafish_engine/ios/Classes/pikafish
+    make -j bridge ARCH=x86-64-avx2
+    cd ../../../tools
+    g++ -std=c++17 -O2 -I../ios/Classes bridge_driver.cpp \
+        -L../ios/Classes/pikafish -lpikafish_bridge -lpthread -o bridge_driver
+
+  Chạy:
+
+    LD_LIBRARY_PATH=../ios/Classes/pikafish ./bridge_driver \
+        [--evalfile pikafish.nnue] [--script session.txt] [--repeat N]
+
+  Kịch bản là các lệnh UCI, mỗi dòng một lệnh. Sau "go" driver chờ "bestmove"
+  (trừ "go infinite"/"go ponder"), sau "isready" chờ "readyok", sau "uci" chờ
+  "uciok". "reanalyze" chờ "bestmove" nếu search có giới hạn, ngược lại chờ dòng
+  info PV đầu tiên của search mới. Dòng trống và dòng bắt đầu bằng '#' được bỏ qua.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+
+#include "pikafish_bridge.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* DefaultScript[] = {
+  "ucinewgame",
+  "isready",
+  "position startpos",
+  "go depth 10",
+  "position startpos moves h2e2 h9g7",
+  "go depth 10",
+  "position fen r1bakab1r/9/1cn3nc1/p1p1p1p1p/9/9/P1P1P1P1P/1C2C1N2/9/RNBAKAB1R b",
+  "go depth 10",
+  "go movetime 200",
+  "isready",
+  "reanalyze multipv 3 startpos",
+  "reanalyze append h2e2",
+  "reanalyze append h9g7",
+  "reanalyze undo 1 append b9c7",
+  "reanalyze multipv 1 go depth 8",
+  "isready",
+};
+
+struct Stats {
+    uint64_t lines = 0, bytes = 0;
+    std::map<std::string, std::vector<double>> latencyMs;  // theo lệnh UCI
+};
+
+int  notifyFd = -1;
+char readBuf[1 << 16];
+
+uint64_t reanalyze_count() {
+    uint64_t n = 0;
+    get_reanalyze_stats_ios(&n, nullptr, nullptr, nullptr);
+    return n;
+}
+
+// Đọc output cho đến khi gặp dòng bắt đầu bằng 'expect'. 'expect' rỗng: chờ
+// dòng PV đầu tiên của search do reanalyze khởi động (bộ đếm vượt 'reanalyzed')
+void wait_for(const char* expect, Stats& stats, uint64_t reanalyzed) {
+    const size_t expectLen = std::strlen(expect);
+
+    while (true)
+    {
+        int n;
+        bool found = false;
+        while ((n = read_all_stdout_ios(readBuf, sizeof(readBuf))) > 0)
+        {
+            stats.bytes += n;
+            for (char *line = readBuf, *end; line < readBuf + n; line = end + 1)
+            {
+                end = std::strchr(line, '\n');
+                if (!end)
+                    end = readBuf + n;
+                stats.lines++;
+                found |= expectLen && std::strncmp(line, expect, expectLen) == 0;
+            }
+        }
+
+        if (found || (!expectLen && reanalyze_count() > reanalyzed))
+            return;
+
+        pollfd pfd = {notifyFd, POLLIN, 0};
+        poll(&pfd, 1, 100);
+    }
+}
+
+const char* reply_for(const std::string& cmd) {
+    if (cmd == "uci")
+        return "uciok";
+    if (cmd == "isready")
+        return "readyok";
+
+    const auto go      = cmd.find("go");
+    const bool bounded = go != std::string::npos && cmd.find("infinite") == std::string::npos
+                      && cmd.find("ponder") == std::string::npos;
+    if (cmd.rfind("reanalyze", 0) == 0)
+        return bounded ? "bestmove" : "";
+    if (go == 0 && bounded)
+        return "bestmove";
+    return nullptr;
+}
+
+void run(const std::string& cmd, Stats& stats) {
+    const char*    expect     = reply_for(cmd);
+    const uint64_t reanalyzed = reanalyze_count();
+    const auto     start      = Clock::now();
+
+    send_command_ios(cmd.c_str());
+
+    if (!expect)
+        return;
+
+    wait_for(expect, stats, reanalyzed);
+    const std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+
+    const std::string key = cmd.substr(0, cmd.find(' '));
+    stats.latencyMs[key].push_back(elapsed.count());
+}
+
+double percentile(std::vector<double> v, double p) {
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, size_t(p * v.size()))];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string              evalFile;
+    std::vector<std::string> script(std::begin(DefaultScript), std::end(DefaultScript));
+    int                      repeat = 5;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string opt = argv[i];
+        if (opt == "--evalfile")
+            evalFile = argv[i + 1];
+        else if (opt == "--repeat")
+            repeat = std::max(1, std::atoi(argv[i + 1]));
+        else if (opt == "--script")
+        {
+            std::ifstream in(argv[i + 1]);
+            if (!in)
+            {
+                std::fprintf(stderr, "cannot open %s\n", argv[i + 1]);
+                return 1;
+            }
+            script.clear();
+            for (std::string line; std::getline(in, line);)
+                if (!line.empty() && line[0] != '#')
+                    script.push_back(line);
+        }
+    }
+
+    notifyFd = get_output_notify_fd_ios();
+    init_pikafish_ios();
+
+    Stats setup;
+    run("uci", setup);
+    if (!evalFile.empty())
+        run("setoption name EvalFile value " + evalFile, setup);
+    run("isready", setup);
+
+    Stats      stats;
+    const auto start = Clock::now();
+
+    for (int r = 0; r < repeat; ++r)
+        for (const auto& cmd : script)
+            run(cmd, stats);
+
+    const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+    shutdown_pikafish_ios(0);
+
+    uint64_t dropped = 0, overflows = 0;
+    get_output_stats_ios(&dropped, &overflows);
+
+    uint64_t reanalyzed = 0, lastUs = 0, maxUs = 0, totalUs = 0;
+    get_reanalyze_stats_ios(&reanalyzed, &lastUs, &maxUs, &totalUs);
+
+    std::fprintf(stderr, "\n%-10s %6s %10s %10s %10s %10s\n", "command", "count", "min ms",
+                 "median ms", "p95 ms", "max ms");
+    for (const auto& [cmd, v] : stats.latencyMs)
+        std::fprintf(stderr, "%-10s %6zu %10.2f %10.2f %10.2f %10.2f\n", cmd.c_str(), v.size(),
+                     *std::min_element(v.begin(), v.end()), percentile(v, 0.5),
+                     percentile(v, 0.95), *std::max_element(v.begin(), v.end()));
+
+    std::fprintf(stderr, "\noutput     : %llu lines, %llu bytes in %.2f s\n",
+                 (unsigned long long) stats.lines, (unsigned long long) stats.bytes,
+                 elapsed.count());
+    std::fprintf(stderr, "throughput : %.0f lines/s, %.1f KB/s\n", stats.lines / elapsed.count(),
+                 stats.bytes / elapsed.count() / 1024);
+    std::fprintf(stderr, "dropped    : %llu lines (%llu overflows)\n",
+                 (unsigned long long) dropped, (unsigned long long) overflows);
+    if (reanalyzed)
+        std::fprintf(stderr, "reanalyze  : stop-to-first-info avg %.2f ms, max %.2f ms (%llu)\n",
+                     totalUs / 1000.0 / reanalyzed, maxUs / 1000.0,
+                     (unsigned long long) reanalyzed);
+
+    return 0;
+}
@@ -0,0 +1,138 @@
+/*
+  So sánh bộ nhớ: N engine trong một process (engine_create) với N process,
+  mỗi process một engine. Đo Pss từ /proc/<pid>/smaps_rollup sau khi mọi
+  engine đã nạp network và trả lời "readyok". Chỉ chạy trên Linux.
+
+  Build (Linux):
+
+    cd packages/pikafish_engine/ios/Classes/pikafish
+    make -j bridge ARCH=x86-64-avx2
+    cd ../../../tools
+    g++ -std=c++17 -O2 -I../ios/Classes multi_engine_bench.cpp \
+        -L../ios/Classes/pikafish -lpikafish_bridge -lpthread -o multi_engine_bench
+
+  Chạy:
+
+    LD_LIBRARY_PATH=../ios/Classes/pikafish ./multi_engine_bench 4 pikafish.nnue
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "pikafish_bridge.h"
+
+static long pss_kb(pid_t pid) {
+    std::ifstream in("/proc/" + std::to_string(pid) + "/smaps_rollup");
+    std::string   line;
+
+    while (std::getline(in, line))
+        if (line.rfind("Pss:", 0) == 0)
+            return std::strtol(line.c_str() + 4, nullptr, 10);
+
+    return -1;
+}
+
+static pikafish_engine_t* start_engine(const char* evalFile) {
+    pikafish_engine_t* e = engine_create();
+
+    if (evalFile)
+        engine_send(e, (std::string("setoption name EvalFile value ") + evalFile).c_str());
+
+    engine_send(e, "isready");
+    return e;
+}
+
+static void wait_ready(pikafish_engine_t* e) {
+    static char buf[1 << 16];
+
+    while (true)
+    {
+        if (engine_read(e, buf, sizeof(buf)) && std::strstr(buf, "readyok"))
+            return;
+        usleep(1000);
+    }
+}
+
+int main(int argc, char** argv) {
+    const int   n        = argc > 1 ? std::atoi(argv[1]) : 4;
+    const char* evalFile = argc > 2 ? argv[2] : nullptr;
+
+    if (n < 1)
+    {
+        std::fprintf(stderr, "usage: %s <engines> [evalfile]\n", argv[0]);
+        return 1;
+    }
+
+    // N process, mỗi process một engine. Con báo sẵn sàng qua 'ready' rồi
+    // chờ cha đóng 'hold' mới thoát.
+    int ready[2], hold[2];
+    if (pipe(ready) || pipe(hold))
+        return 1;
+
+    std::vector<pid_t> children;
+    for (int i = 0; i < n; ++i)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            close(ready[0]);
+            close(hold[1]);
+
+            pikafish_engine_t* e = start_engine(evalFile);
+            wait_ready(e);
+
+            char c = 1;
+            (void) !write(ready[1], &c, 1);
+            (void) !read(hold[0], &c, 1);
+
+            engine_destroy(e);
+            _exit(0);
+        }
+        children.push_back(pid);
+    }
+
+    close(ready[1]);
+    close(hold[0]);
+
+    for (int i = 0; i < n; ++i)
+    {
+        char c;
+        (void) !read(ready[0], &c, 1);
+    }
+
+    long multiProcess = 0;
+    for (pid_t pid : children)
+        multiProcess += pss_kb(pid);
+
+    close(hold[1]);
+    for (pid_t pid : children)
+        waitpid(pid, nullptr, 0);
+
+    // N engine trong process hiện tại
+    std::vector<pikafish_engine_t*> engines;
+    for (int i = 0; i < n; ++i)
+        engines.push_back(start_engine(evalFile));
+    for (pikafish_engine_t* e : engines)
+        wait_ready(e);
+
+    long singleProcess = pss_kb(getpid());
+
+    for (pikafish_engine_t* e : engines)
+        engine_destroy(e);
+
+    std::printf("engines            : %d\n", n);
+    std::printf("%d processes (Pss) : %ld kB (%ld kB/engine)\n", n, multiProcess,
+                multiProcess / n);
+    std::printf("1 process   (Pss) : %ld kB (%ld kB/engine)\n", singleProcess,
+                singleProcess / n);
+    std::printf("saved              : %ld kB\n", multiProcess - singleProcess);
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+/*
+  Đo thời gian khởi động engine qua C API (init_pikafish_ios -> "readyok" với
+  network đã nạp) và peak RSS của process, theo hai cách đưa network vào:
+
+    file   : "setoption name EvalFile value <file>" như App làm trước đây
+    buffer : mmap file rồi set_network_buffer_ios trước init_pikafish_ios
+
+  Mỗi cách nên chạy trong process riêng vì peak RSS không giảm lại được.
+
+  Build (Linux):
+
+    cd packages/pikafish_engine/ios/Classes/pikafish
+    make -j bridge ARCH=x86-64-avx2
+    cd ../../../tools
+    g++ -std=c++17 -O2 -I../ios/Classes nnue_startup.cpp \
+        -L../ios/Classes/pikafish -lpikafish_bridge -lpthread -o nnue_startup
+
+  Chạy:
+
+    LD_LIBRARY_PATH=../ios/Classes/pikafish ./nnue_startup file pikafish.nnue
+    LD_LIBRARY_PATH=../ios/Classes/pikafish ./nnue_startup buffer pikafish.nnue
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pikafish_bridge.h"
+
+static char readBuf[1 << 16];
+
+// Đọc output cho đến khi có dòng bắt đầu bằng 'expect'
+static void wait_for(const char* expect, int notifyFd) {
+    const size_t expectLen = std::strlen(expect);
+
+    while (true)
+    {
+        int n;
+        while ((n = read_all_stdout_ios(readBuf, sizeof(readBuf) - 1)) > 0)
+        {
+            readBuf[n] = '\0';
+            for (char* line = readBuf; line && *line; line = std::strchr(line, '\n'))
+            {
+                line += *line == '\n';
+                if (std::strncmp(line, expect, expectLen) == 0)
+                    return;
+            }
+        }
+
+        pollfd pfd = {notifyFd, POLLIN, 0};
+        poll(&pfd, 1, 100);
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3 || (std::strcmp(argv[1], "file") && std::strcmp(argv[1], "buffer")))
+    {
+        std::fprintf(stderr, "usage: %s file|buffer <nnue>\n", argv[0]);
+        return 1;
+    }
+
+    const bool useBuffer = std::strcmp(argv[1], "buffer") == 0;
+    const auto start     = std::chrono::steady_clock::now();
+
+    void*  mapped = nullptr;
+    size_t size   = 0;
+
+    if (useBuffer)
+    {
+        int         fd = open(argv[2], O_RDONLY);
+        struct stat st;
+        if (fd == -1 || fstat(fd, &st) != 0)
+        {
+            std::fprintf(stderr, "cannot open %s\n", argv[2]);
+            return 1;
+        }
+        size   = size_t(st.st_size);
+        mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED)
+        {
+            std::fprintf(stderr, "cannot map %s\n", argv[2]);
+            return 1;
+        }
+        set_network_buffer_ios(nullptr, mapped, size);
+    }
+
+    const int notifyFd = get_output_notify_fd_ios();
+    init_pikafish_ios();
+
+    if (!useBuffer)
+        send_command_ios((std::string("setoption name EvalFile value ") + argv[2]).c_str());
+
+    send_command_ios("isready");
+    wait_for("readyok", notifyFd);
+
+    const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    std::printf("%-6s: readyok after %.1f ms, peak RSS %ld MB\n", argv[1], elapsed.count(),
+                usage.ru_maxrss / 1024);
+
+    shutdown_pikafish_ios(0);
+
+    if (mapped)
+    {
+        set_network_buffer_ios(nullptr, nullptr, 0);
+        munmap(mapped, size);
+    }
+
+    return 0;
+}